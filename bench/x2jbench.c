@@ -0,0 +1,344 @@
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 2014, Florian Mueller                      */
+/* ======================================================================== */
+
+/* End-to-end benchmark: creates a fake X-Arcade stick through uinput,
+ * starts the daemon on it and measures the time from a key written into
+ * the stick to the event showing up on the first virtual gamepad. */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+#include <linux/input.h>
+#include <linux/uinput.h>
+
+#include "latency.h"
+
+/* the name and ids the daemon looks for by default */
+#define BENCH_STICK_NAME "XGaming X-Arcade"
+#define BENCH_STICK_VENDOR 0xaa55
+#define BENCH_STICK_PRODUCT 0x0101
+#define BENCH_GPAD_NAME "Xarcade-to-Gamepad Device 1"
+/* how long the daemon may take to come up, in ms */
+#define BENCH_START_MS 5000
+/* an event that did not arrive within this is counted as lost, in ms */
+#define BENCH_LOST_MS 100
+#define BENCH_ARGS_MAX 32
+
+/* player 1 buttons of the built-in layout, none of them is part of a chord */
+static const uint16_t benchKeys[] = {
+	KEY_LEFTCTRL, KEY_LEFTALT, KEY_SPACE, KEY_LEFTSHIFT, KEY_Z, KEY_X
+};
+#define BENCH_KEYS (sizeof(benchKeys) / sizeof(benchKeys[0]))
+
+// declaration of supplementary functions  -------------------
+static int createStick();
+static int16_t stickNode(int stick, char *path, size_t len);
+static int16_t injectKeys(int stick, const uint16_t *keys, int count,
+		int value, uint64_t *written);
+static int findGamepad(int timeout);
+static int awaitEvents(int gpad, int count, LATENCY_HIST *hist,
+		uint64_t written);
+static void runPaced(int stick, int gpad, unsigned long presses,
+		unsigned long interval);
+static void runBurst(int stick, int gpad, unsigned long frames);
+static pid_t startDaemon(const char *path, const char *node, int argc,
+		char *argv[]);
+static void usage(const char *name);
+
+int main(int argc, char *argv[]) {
+	const char *daemonPath = "./xarcade2jstick";
+	char node[300];
+	unsigned long presses = 1000, interval = 5, frames = 1000;
+	int stick, gpad, status, opt;
+	pid_t pid;
+
+	while ((opt = getopt(argc, argv, "d:n:i:b:")) != -1) {
+		switch (opt) {
+			case 'd':
+				daemonPath = optarg;
+				break;
+			case 'n':
+				presses = strtoul(optarg, NULL, 10);
+				break;
+			case 'i':
+				interval = strtoul(optarg, NULL, 10);
+				break;
+			case 'b':
+				frames = strtoul(optarg, NULL, 10);
+				break;
+			default:
+				usage(argv[0]);
+				break;
+		}
+	}
+
+	stick = createStick();
+	if (stick < 0)
+		return EXIT_FAILURE;
+	if (stickNode(stick, node, sizeof(node)) != 0) {
+		printf("[bench] Unable to find the event node of the stick\n");
+		ioctl(stick, UI_DEV_DESTROY);
+		close(stick);
+		return EXIT_FAILURE;
+	}
+	pid = startDaemon(daemonPath, node, argc - optind, argv + optind);
+	if (pid < 0) {
+		ioctl(stick, UI_DEV_DESTROY);
+		return EXIT_FAILURE;
+	}
+
+	gpad = findGamepad(BENCH_START_MS);
+	if (gpad < 0) {
+		printf("[bench] No \"%s\" showed up\n", BENCH_GPAD_NAME);
+	} else {
+		if (presses > 0)
+			runPaced(stick, gpad, presses, interval);
+		if (frames > 0)
+			runBurst(stick, gpad, frames);
+		close(gpad);
+	}
+
+	kill(pid, SIGINT);
+	waitpid(pid, &status, 0);
+	ioctl(stick, UI_DEV_DESTROY);
+	close(stick);
+	return gpad < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+// supplementary functions -------------------
+
+/* a keyboard named like an X-Arcade, the daemon takes it for one */
+static int createStick() {
+	struct uinput_setup setup;
+	int fd, code;
+
+	fd = open("/dev/uinput", O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+	if (fd < 0) {
+		printf("[bench] Unable to open /dev/uinput: %s\n", strerror(errno));
+		return -1;
+	}
+	ioctl(fd, UI_SET_EVBIT, EV_KEY);
+	for (code = KEY_ESC; code < BTN_MISC; code++)
+		ioctl(fd, UI_SET_KEYBIT, code);
+
+	memset(&setup, 0, sizeof(setup));
+	snprintf(setup.name, sizeof(setup.name), "%s", BENCH_STICK_NAME);
+	setup.id.bustype = BUS_USB;
+	setup.id.vendor = BENCH_STICK_VENDOR;
+	setup.id.product = BENCH_STICK_PRODUCT;
+	if (ioctl(fd, UI_DEV_SETUP, &setup) != 0 || ioctl(fd, UI_DEV_CREATE) != 0) {
+		printf("[bench] Unable to create the stick: %s\n", strerror(errno));
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/* the /dev/input/event* node of the stick, so that the daemon is given
+ * this one and leaves a real X-Arcade alone */
+static int16_t stickNode(int stick, char *path, size_t len) {
+	char sysname[64], dirPath[128];
+	struct dirent *entry;
+	DIR *dir;
+
+	memset(sysname, 0, sizeof(sysname));
+	if (ioctl(stick, UI_GET_SYSNAME(sizeof(sysname) - 1), sysname) < 0)
+		return -1;
+	snprintf(dirPath, sizeof(dirPath), "/sys/devices/virtual/input/%s", sysname);
+	dir = opendir(dirPath);
+	while (dir != NULL && (entry = readdir(dir)) != NULL) {
+		if (strncmp(entry->d_name, "event", 5) != 0)
+			continue;
+		snprintf(path, len, "/dev/input/%s", entry->d_name);
+		closedir(dir);
+		printf("[bench] Writing %s\n", path);
+		return 0;
+	}
+	if (dir != NULL)
+		closedir(dir);
+	return -1;
+}
+
+/* writes count keys and a SYN_REPORT as one frame, written is the
+ * monotonic time right before the write */
+static int16_t injectKeys(int stick, const uint16_t *keys, int count,
+		int value, uint64_t *written) {
+	struct input_event ev[BENCH_KEYS + 1];
+	size_t len = (count + 1) * sizeof(ev[0]);
+	int ctr;
+
+	memset(ev, 0, sizeof(ev));
+	for (ctr = 0; ctr < count; ctr++) {
+		ev[ctr].type = EV_KEY;
+		ev[ctr].code = keys[ctr];
+		ev[ctr].value = value;
+	}
+	ev[count].type = EV_SYN;
+	ev[count].code = SYN_REPORT;
+	*written = latency_now();
+	return write(stick, ev, len) == (ssize_t) len ? 0 : -1;
+}
+
+/* the first virtual gamepad of the daemon, with monotonic timestamps */
+static int findGamepad(int timeout) {
+	char path[300], name[256];
+	struct dirent *entry;
+	int clk = CLOCK_MONOTONIC;
+	int waited, fd;
+	DIR *dir;
+
+	for (waited = 0; waited < timeout; waited += 50) {
+		dir = opendir("/dev/input");
+		while (dir != NULL && (entry = readdir(dir)) != NULL) {
+			if (strncmp(entry->d_name, "event", 5) != 0)
+				continue;
+			snprintf(path, sizeof(path), "/dev/input/%s", entry->d_name);
+			fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+			if (fd < 0)
+				continue;
+			memset(name, 0, sizeof(name));
+			ioctl(fd, EVIOCGNAME(sizeof(name) - 1), name);
+			if (strcmp(name, BENCH_GPAD_NAME) == 0
+					&& ioctl(fd, EVIOCSCLOCKID, &clk) == 0) {
+				closedir(dir);
+				printf("[bench] Reading %s\n", path);
+				return fd;
+			}
+			close(fd);
+		}
+		if (dir != NULL)
+			closedir(dir);
+		usleep(50000);
+	}
+	return -1;
+}
+
+/* reads until count events other than SYN arrived, each one goes into
+ * hist with its kernel timestamp. Returns how many arrived in time. */
+static int awaitEvents(int gpad, int count, LATENCY_HIST *hist,
+		uint64_t written) {
+	struct input_event ev[64];
+	struct pollfd pfd = { .fd = gpad, .events = POLLIN };
+	uint64_t stamp;
+	int got = 0, rd, ctr;
+
+	while (got < count && poll(&pfd, 1, BENCH_LOST_MS) > 0) {
+		rd = read(gpad, ev, sizeof(ev));
+		for (ctr = 0; ctr < rd / (int) sizeof(ev[0]); ctr++) {
+			if (ev[ctr].type == EV_SYN)
+				continue;
+			stamp = latency_timeval_ns(&ev[ctr].time);
+			latency_record(hist, stamp > written ? stamp - written : 0);
+			got++;
+		}
+	}
+	return got < count ? got : count;
+}
+
+/* one button pressed and released again and again, the stick idles between */
+static void runPaced(int stick, int gpad, unsigned long presses,
+		unsigned long interval) {
+	static LATENCY_HIST hist;
+	uint64_t written;
+	unsigned long lost = 0, ctr;
+	int value;
+	char line[200];
+
+	for (ctr = 0; ctr < presses * 2; ctr++) {
+		value = ctr % 2 == 0;
+		if (injectKeys(stick, benchKeys, 1, value, &written) != 0) {
+			printf("[bench] Unable to write to the stick: %s\n", strerror(errno));
+			return;
+		}
+		lost += 1 - awaitEvents(gpad, 1, &hist, written);
+		usleep(interval * 1000);
+	}
+	latency_format(&hist, "paced", line, sizeof(line));
+	printf("[bench] %s lost=%lu\n", line, lost);
+}
+
+/* all buttons at once, the next frame as soon as the last one came out */
+static void runBurst(int stick, int gpad, unsigned long frames) {
+	static LATENCY_HIST hist;
+	uint64_t written, start;
+	unsigned long events = 0, ctr;
+	double secs;
+	char line[200];
+
+	start = latency_now();
+	for (ctr = 0; ctr < frames * 2; ctr++) {
+		if (injectKeys(stick, benchKeys, BENCH_KEYS, ctr % 2 == 0, &written) != 0) {
+			printf("[bench] Unable to write to the stick: %s\n", strerror(errno));
+			return;
+		}
+		events += awaitEvents(gpad, BENCH_KEYS, &hist, written);
+	}
+	secs = (latency_now() - start) / 1e9;
+	latency_format(&hist, "burst", line, sizeof(line));
+	printf("[bench] %s lost=%lu\n", line, frames * 2 * BENCH_KEYS - events);
+	printf("[bench] %lu events in %.3f s, %.0f events/s\n", events, secs,
+			secs > 0 ? events / secs : 0);
+}
+
+/* the daemon with a layout of its own and nothing that could collide
+ * with an installed one, only on the node of the fake stick. Extra
+ * arguments come last and win. */
+static pid_t startDaemon(const char *path, const char *node, int argc,
+		char *argv[]) {
+	char *args[BENCH_ARGS_MAX];
+	int count = 0, ctr;
+	pid_t pid;
+
+	args[count++] = (char *) path;
+	args[count++] = "-c";
+	args[count++] = "/dev/null";
+	args[count++] = "--control";
+	args[count++] = "none";
+	args[count++] = "--state";
+	args[count++] = "none";
+	args[count++] = "--device";
+	args[count++] = (char *) node;
+	for (ctr = 0; ctr < argc && count < BENCH_ARGS_MAX - 1; ctr++)
+		args[count++] = argv[ctr];
+	args[count] = NULL;
+
+	pid = fork();
+	if (pid == 0) {
+		execv(path, args);
+		printf("[bench] Unable to start %s: %s\n", path, strerror(errno));
+		_exit(EXIT_FAILURE);
+	}
+	if (pid < 0)
+		printf("[bench] Unable to start %s: %s\n", path, strerror(errno));
+	return pid;
+}
+
+static void usage(const char *name) {
+	fprintf(stderr, "Usage: %s [-d daemon] [-n presses] [-i interval ms]\n"
+			"          [-b burst frames] [-- daemon arguments]\n", name);
+	exit(EXIT_FAILURE);
+}
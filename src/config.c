@@ -0,0 +1,517 @@
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 2014, Florian Mueller                      */
+/* ======================================================================== */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "config.h"
+#include "keynames.h"
+
+/* maximum number of words in one configuration line */
+#define CONFIG_ARGS_MAX 8
+
+typedef int16_t (*CONFIG_DIRECTIVE_FN)(CONFIG* const config, int argc,
+		char *argv[]);
+
+typedef struct {
+	const char *name;
+	CONFIG_DIRECTIVE_FN fn;
+} CONFIG_DIRECTIVE;
+
+// declaration of supplementary functions  -------------------
+static int16_t config_clear(CONFIG* const config, int argc, char *argv[]);
+static int16_t config_map(CONFIG* const config, int argc, char *argv[]);
+static int16_t config_unmap(CONFIG* const config, int argc, char *argv[]);
+static int16_t config_passthrough(CONFIG* const config, int argc, char *argv[]);
+static int16_t config_chord(CONFIG* const config, int argc, char *argv[]);
+static int16_t config_chord_window(CONFIG* const config, int argc, char *argv[]);
+static int16_t config_units(CONFIG* const config, int argc, char *argv[]);
+static int16_t config_read_buffer(CONFIG* const config, int argc, char *argv[]);
+static int16_t config_match(CONFIG* const config, int argc, char *argv[]);
+static int16_t config_socd(CONFIG* const config, int argc, char *argv[]);
+static int16_t config_directions(CONFIG* const config, int argc, char *argv[]);
+static int16_t config_timestamps(CONFIG* const config, int argc, char *argv[]);
+static int16_t config_debounce(CONFIG* const config, int argc, char *argv[]);
+static int16_t config_debounce_key(CONFIG* const config, int argc, char *argv[]);
+static int16_t config_turbo(CONFIG* const config, int argc, char *argv[]);
+static int16_t config_rt_priority(CONFIG* const config, int argc, char *argv[]);
+static int16_t config_rt_cpu(CONFIG* const config, int argc, char *argv[]);
+static int16_t config_target(int argc, char *argv[], KEYMAP_ACTION_E *action,
+		uint8_t *player, uint16_t *code, KEYMAP_XFORM_E *xform);
+static int16_t config_source(const char *name, uint16_t *code);
+static int16_t config_xform(const char *name, KEYMAP_XFORM_E *xform);
+
+static const CONFIG_DIRECTIVE config_directives[] = {
+	{ "clear", config_clear },
+	{ "map", config_map },
+	{ "unmap", config_unmap },
+	{ "passthrough", config_passthrough },
+	{ "chord", config_chord },
+	{ "chord_window", config_chord_window },
+	{ "units", config_units },
+	{ "read_buffer", config_read_buffer },
+	{ "match", config_match },
+	{ "socd", config_socd },
+	{ "directions", config_directions },
+	{ "timestamps", config_timestamps },
+	{ "debounce", config_debounce },
+	{ "debounce_key", config_debounce_key },
+	{ "turbo", config_turbo },
+	{ "realtime_priority", config_rt_priority },
+	{ "realtime_cpu", config_rt_cpu },
+};
+
+// relizations ----------------------
+void config_set_default(CONFIG* const config) {
+	keymap_set_default(&config->keymap);
+	config->units = 1;
+	config->read_buffer = INPUT_XARC_EVS_DEFAULT;
+	input_xarcade_match_default(&config->matchers);
+	config->socd = STICK_SOCD_LAST;
+	config->chord_window = CONFIG_CHORD_WINDOW_DEFAULT;
+	config->timestamps = UINPUT_BATCH_STAMP_NOW;
+	debounce_set_default(&config->debounce);
+	turbo_set_default(&config->turbo);
+	memset(config->directions, UINPUT_GPAD_DIRS_AXIS, sizeof(config->directions));
+	rt_set_default(&config->rt);
+}
+
+/* applies the directives of a configuration file on top of config */
+int16_t config_load(CONFIG* const config, const char *path) {
+	char line[256];
+	char *argv[CONFIG_ARGS_MAX];
+	char *saveptr;
+	int argc;
+	int lineno = 0;
+	int16_t result = 0;
+	unsigned int ctr;
+	FILE *file;
+
+	file = fopen(path, "r");
+	if (file == NULL) {
+		printf("[config] Unable to open %s: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	while (fgets(line, sizeof(line), file) != NULL) {
+		lineno++;
+		line[strcspn(line, "#\r\n")] = '\0';
+
+		argc = 0;
+		argv[argc] = strtok_r(line, " \t", &saveptr);
+		while (argv[argc] != NULL && argc < CONFIG_ARGS_MAX - 1)
+			argv[++argc] = strtok_r(NULL, " \t", &saveptr);
+		if (argc == 0)
+			continue;
+
+		for (ctr = 0; ctr < sizeof(config_directives) / sizeof(config_directives[0]); ctr++) {
+			if (strcmp(config_directives[ctr].name, argv[0]) == 0)
+				break;
+		}
+		if (ctr == sizeof(config_directives) / sizeof(config_directives[0])) {
+			printf("[config] %s:%d: unknown directive '%s'\n", path, lineno, argv[0]);
+			result = -1;
+		} else if (config_directives[ctr].fn(config, argc, argv) != 0) {
+			printf("[config] %s:%d: invalid '%s' line\n", path, lineno, argv[0]);
+			result = -1;
+		}
+	}
+	fclose(file);
+	return result;
+}
+
+// supplementary functions -------------------
+
+/* clear */
+static int16_t config_clear(CONFIG* const config, int argc, char *argv[]) {
+	if (argc != 1)
+		return -1;
+	keymap_clear(&config->keymap);
+	return 0;
+}
+
+/* map <source> gamepad <player> <target> [button|tap|axis-|axis+]
+ * map <source> keyboard <target> [button|tap] */
+static int16_t config_map(CONFIG* const config, int argc, char *argv[]) {
+	KEYMAP_ACTION_E action;
+	KEYMAP_XFORM_E xform;
+	uint16_t source, code;
+	uint8_t player;
+
+	if (argc < 4 || config_source(argv[1], &source) != 0)
+		return -1;
+	if (config_target(argc - 2, argv + 2, &action, &player, &code, &xform) != 0)
+		return -1;
+	return keymap_set(&config->keymap, source, action, player, code, xform);
+}
+
+/* chord <source>+<source>[+...] gamepad <player> <target> [button|tap|axis-|axis+]
+ * chord <source>+<source>[+...] keyboard <target> [button|tap] */
+static int16_t config_chord(CONFIG* const config, int argc, char *argv[]) {
+	KEYMAP_ACTION_E action;
+	KEYMAP_XFORM_E xform;
+	uint16_t keys[KEYMAP_CHORD_KEYS];
+	uint16_t code;
+	uint8_t player, count = 0;
+	char *name, *save;
+
+	if (argc < 4)
+		return -1;
+	for (name = strtok_r(argv[1], "+", &save); name != NULL;
+			name = strtok_r(NULL, "+", &save)) {
+		if (count == KEYMAP_CHORD_KEYS || config_source(name, &keys[count]) != 0)
+			return -1;
+		count++;
+	}
+	if (config_target(argc - 2, argv + 2, &action, &player, &code, &xform) != 0)
+		return -1;
+	return keymap_chord_add(&config->keymap, keys, count, action, player, code,
+			xform);
+}
+
+/* chord_window <ms> */
+static int16_t config_chord_window(CONFIG* const config, int argc, char *argv[]) {
+	unsigned long ms;
+	char *end;
+
+	if (argc != 2)
+		return -1;
+	ms = strtoul(argv[1], &end, 10);
+	if (*end != '\0' || ms < 1 || ms > 1000)
+		return -1;
+	config->chord_window = ms * 1000;
+	return 0;
+}
+
+/* unmap <source> */
+static int16_t config_unmap(CONFIG* const config, int argc, char *argv[]) {
+	uint16_t source;
+
+	if (argc != 2 || config_source(argv[1], &source) != 0)
+		return -1;
+	return keymap_set(&config->keymap, source, KEYMAP_ACTION_NONE, 0, 0,
+			KEYMAP_XFORM_BUTTON);
+}
+
+/* passthrough off|unmapped
+ * passthrough <source> [<source>...] */
+static int16_t config_passthrough(CONFIG* const config, int argc, char *argv[]) {
+	KEYMAP *keymap = &config->keymap;
+	uint16_t source;
+	int arg;
+
+	if (argc < 2)
+		return -1;
+	if (argc == 2 && strcmp(argv[1], "off") == 0) {
+		memset(keymap->passthrough, 0, sizeof(keymap->passthrough));
+		return 0;
+	}
+	if (argc == 2 && strcmp(argv[1], "unmapped") == 0) {
+		for (source = KEY_RESERVED + 1; source < KEYMAP_PASSTHROUGH_LEN; source++)
+			keymap_passthrough(keymap, source, 1);
+		return 0;
+	}
+	for (arg = 1; arg < argc; arg++) {
+		if (config_source(argv[arg], &source) != 0
+				|| keymap_passthrough(keymap, source, 1) != 0)
+			return -1;
+	}
+	return 0;
+}
+
+/* units <number of sticks> */
+static int16_t config_units(CONFIG* const config, int argc, char *argv[]) {
+	unsigned long units;
+	char *end;
+
+	if (argc != 2)
+		return -1;
+	units = strtoul(argv[1], &end, 10);
+	if (*end != '\0' || units < 1 || units > INPUT_XARC_DEVS_MAX)
+		return -1;
+	config->units = units;
+	return 0;
+}
+
+/* read_buffer <events> */
+static int16_t config_read_buffer(CONFIG* const config, int argc, char *argv[]) {
+	unsigned long events;
+	char *end;
+
+	if (argc != 2)
+		return -1;
+	events = strtoul(argv[1], &end, 10);
+	if (*end != '\0' || events < 16 || events > 4096)
+		return -1;
+	config->read_buffer = events;
+	return 0;
+}
+
+/* match clear
+ * match name <pattern>
+ * match id <vendor>:<product> */
+static int16_t config_match(CONFIG* const config, int argc, char *argv[]) {
+	char name[80];
+	unsigned long vendor, product;
+	char *end;
+	int arg;
+
+	if (argc == 2 && strcmp(argv[1], "clear") == 0) {
+		config->matchers.count = 0;
+		return 0;
+	}
+	if (argc == 3 && strcmp(argv[1], "id") == 0) {
+		vendor = strtoul(argv[2], &end, 16);
+		if (*end != ':' || vendor > 0xffff)
+			return -1;
+		product = strtoul(end + 1, &end, 16);
+		if (*end != '\0' || product > 0xffff)
+			return -1;
+		return input_xarcade_match_add(&config->matchers, INPUT_XARC_MATCH_ID,
+				NULL, vendor, product);
+	}
+	if (argc < 3 || strcmp(argv[1], "name") != 0)
+		return -1;
+	/* names may contain blanks, the words are joined by single ones */
+	name[0] = '\0';
+	for (arg = 2; arg < argc; arg++) {
+		if (strlen(name) + strlen(argv[arg]) + 2 > sizeof(name))
+			return -1;
+		if (arg > 2)
+			strcat(name, " ");
+		strcat(name, argv[arg]);
+	}
+	return input_xarcade_match_add(&config->matchers, INPUT_XARC_MATCH_NAME,
+			name, 0, 0);
+}
+
+/* socd last|neutral|first */
+static int16_t config_socd(CONFIG* const config, int argc, char *argv[]) {
+	if (argc != 2)
+		return -1;
+	if (strcmp(argv[1], "last") == 0)
+		config->socd = STICK_SOCD_LAST;
+	else if (strcmp(argv[1], "neutral") == 0)
+		config->socd = STICK_SOCD_NEUTRAL;
+	else if (strcmp(argv[1], "first") == 0)
+		config->socd = STICK_SOCD_FIRST;
+	else
+		return -1;
+	return 0;
+}
+
+/* timestamps now|source, older kernels drop source times written to uinput */
+static int16_t config_timestamps(CONFIG* const config, int argc, char *argv[]) {
+	if (argc != 2)
+		return -1;
+	if (strcmp(argv[1], "now") == 0)
+		config->timestamps = UINPUT_BATCH_STAMP_NOW;
+	else if (strcmp(argv[1], "source") == 0)
+		config->timestamps = UINPUT_BATCH_STAMP_SOURCE;
+	else
+		return -1;
+	return 0;
+}
+
+/* debounce off|eager|deferred [ms], ms sets the window of all keys */
+static int16_t config_debounce(CONFIG* const config, int argc, char *argv[]) {
+	unsigned long ms;
+	char *end;
+	int code;
+
+	if (argc != 2 && argc != 3)
+		return -1;
+	if (strcmp(argv[1], "off") == 0)
+		config->debounce.mode = DEBOUNCE_OFF;
+	else if (strcmp(argv[1], "eager") == 0)
+		config->debounce.mode = DEBOUNCE_EAGER;
+	else if (strcmp(argv[1], "deferred") == 0)
+		config->debounce.mode = DEBOUNCE_DEFERRED;
+	else
+		return -1;
+	if (argc == 2)
+		return 0;
+
+	ms = strtoul(argv[2], &end, 10);
+	if (*end != '\0' || ms > 1000)
+		return -1;
+	for (code = 0; code < KEY_CNT; code++)
+		config->debounce.window[code] = ms * 1000;
+	return 0;
+}
+
+/* debounce_key <source> <ms>, 0 leaves the key alone */
+static int16_t config_debounce_key(CONFIG* const config, int argc, char *argv[]) {
+	unsigned long ms;
+	uint16_t source;
+	char *end;
+
+	if (argc != 3 || config_source(argv[1], &source) != 0 || source >= KEY_CNT)
+		return -1;
+	ms = strtoul(argv[2], &end, 10);
+	if (*end != '\0' || ms > 1000)
+		return -1;
+	config->debounce.window[source] = ms * 1000;
+	return 0;
+}
+
+/* turbo <source> <presses per second> [<percent down>]
+ * turbo <source> off */
+static int16_t config_turbo(CONFIG* const config, int argc, char *argv[]) {
+	unsigned long rate, duty = TURBO_DUTY_DEFAULT;
+	uint16_t source;
+	char *end;
+
+	if (argc < 3 || argc > 4 || config_source(argv[1], &source) != 0)
+		return -1;
+	if (argc == 3 && strcmp(argv[2], "off") == 0)
+		return turbo_set(&config->turbo, source, 0, duty);
+	rate = strtoul(argv[2], &end, 10);
+	if (*end != '\0' || rate < 1 || rate > TURBO_RATE_MAX) {
+		printf("[config] turbo rate must be 1 to %d presses per second\n",
+				TURBO_RATE_MAX);
+		return -1;
+	}
+	if (argc == 4) {
+		duty = strtoul(argv[3], &end, 10);
+		if (*end != '\0' || duty < TURBO_DUTY_MIN || duty > TURBO_DUTY_MAX) {
+			printf("[config] turbo duty must be %d to %d percent\n",
+					TURBO_DUTY_MIN, TURBO_DUTY_MAX);
+			return -1;
+		}
+	}
+	return turbo_set(&config->turbo, source, rate, duty);
+}
+
+/* directions <player> axis|hat|dpad */
+static int16_t config_directions(CONFIG* const config, int argc, char *argv[]) {
+	unsigned long player;
+	char *end;
+
+	if (argc != 3)
+		return -1;
+	player = strtoul(argv[1], &end, 10);
+	if (*end != '\0' || player < 1 || player > CONFIG_PLAYERS_MAX)
+		return -1;
+	if (strcmp(argv[2], "axis") == 0)
+		config->directions[player - 1] = UINPUT_GPAD_DIRS_AXIS;
+	else if (strcmp(argv[2], "hat") == 0)
+		config->directions[player - 1] = UINPUT_GPAD_DIRS_HAT;
+	else if (strcmp(argv[2], "dpad") == 0)
+		config->directions[player - 1] = UINPUT_GPAD_DIRS_DPAD;
+	else
+		return -1;
+	return 0;
+}
+
+/* realtime_priority <1..99> */
+static int16_t config_rt_priority(CONFIG* const config, int argc, char *argv[]) {
+	unsigned long priority;
+	char *end;
+
+	if (argc != 2)
+		return -1;
+	priority = strtoul(argv[1], &end, 10);
+	if (*end != '\0' || priority < 1 || priority > 99)
+		return -1;
+	config->rt.priority = priority;
+	return 0;
+}
+
+/* realtime_cpu <cpu number>|none */
+static int16_t config_rt_cpu(CONFIG* const config, int argc, char *argv[]) {
+	unsigned long cpu;
+	char *end;
+
+	if (argc != 2)
+		return -1;
+	if (strcmp(argv[1], "none") == 0) {
+		config->rt.cpu = -1;
+		return 0;
+	}
+	cpu = strtoul(argv[1], &end, 10);
+	if (*end != '\0' || cpu >= RT_CPUS_MAX)
+		return -1;
+	config->rt.cpu = cpu;
+	return 0;
+}
+
+/* gamepad <player> <target> [xform] or keyboard <target> [xform] */
+static int16_t config_target(int argc, char *argv[], KEYMAP_ACTION_E *action,
+		uint8_t *player, uint16_t *code, KEYMAP_XFORM_E *xform) {
+	unsigned long number = 1;
+	int16_t type;
+	char *end;
+	int arg;
+
+	if (strcmp(argv[0], "gamepad") == 0) {
+		number = strtoul(argv[1], &end, 10);
+		if (*end != '\0' || number < 1 || number > 255)
+			return -1;
+		arg = 2;
+	} else if (strcmp(argv[0], "keyboard") == 0) {
+		arg = 1;
+	} else {
+		return -1;
+	}
+	*player = number - 1;
+
+	if (arg >= argc || arg + 2 < argc)
+		return -1;
+	type = keynames_lookup(argv[arg], code);
+	if (type < 0)
+		return -1;
+	*xform = KEYMAP_XFORM_BUTTON;
+	if (arg + 1 < argc && config_xform(argv[arg + 1], xform) != 0)
+		return -1;
+
+	if (argv[0][0] == 'k') {
+		if (type != EV_KEY || (*xform != KEYMAP_XFORM_BUTTON && *xform != KEYMAP_XFORM_TAP))
+			return -1;
+		*action = *xform == KEYMAP_XFORM_TAP ? KEYMAP_ACTION_KBD_TAP : KEYMAP_ACTION_KBD_KEY;
+	} else if (type == EV_ABS) {
+		if (*xform != KEYMAP_XFORM_AXIS_MIN && *xform != KEYMAP_XFORM_AXIS_MAX)
+			return -1;
+		*action = KEYMAP_ACTION_GPAD_ABS;
+	} else {
+		if (*xform != KEYMAP_XFORM_BUTTON && *xform != KEYMAP_XFORM_TAP)
+			return -1;
+		*action = *xform == KEYMAP_XFORM_TAP ? KEYMAP_ACTION_GPAD_TAP : KEYMAP_ACTION_GPAD_KEY;
+	}
+	return 0;
+}
+
+static int16_t config_source(const char *name, uint16_t *code) {
+	return keynames_lookup(name, code) == EV_KEY ? 0 : -1;
+}
+
+static int16_t config_xform(const char *name, KEYMAP_XFORM_E *xform) {
+	if (strcmp(name, "button") == 0)
+		*xform = KEYMAP_XFORM_BUTTON;
+	else if (strcmp(name, "tap") == 0)
+		*xform = KEYMAP_XFORM_TAP;
+	else if (strcmp(name, "axis-") == 0)
+		*xform = KEYMAP_XFORM_AXIS_MIN;
+	else if (strcmp(name, "axis+") == 0)
+		*xform = KEYMAP_XFORM_AXIS_MAX;
+	else
+		return -1;
+	return 0;
+}
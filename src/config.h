@@ -0,0 +1,68 @@
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 2014, Florian Mueller                      */
+/* ======================================================================== */
+
+#ifndef CONFIG_H_
+#define CONFIG_H_
+
+#include <stdint.h>
+
+#include "debounce.h"
+#include "keymap.h"
+#include "input_xarcade.h"
+#include "rt.h"
+#include "stick.h"
+#include "turbo.h"
+#include "uinput_gamepad.h"
+
+/* read at startup if present and no other file is given */
+#define CONFIG_FILE "/etc/xarcade2jstick.conf"
+/* where profile <name> on the control socket looks for <name>.conf */
+#define CONFIG_PROFILE_DIR "/etc/xarcade2jstick.d"
+/* players of one stick that can have settings of their own */
+#define CONFIG_PLAYERS_MAX 16
+/* how long a key that may start a chord waits for the other keys, in us */
+#define CONFIG_CHORD_WINDOW_DEFAULT 30000
+
+typedef struct {
+	KEYMAP keymap;
+	/* number of sticks served, each one gets its own set of gamepads */
+	uint8_t units;
+	/* events fetched from a stick with one read */
+	uint16_t read_buffer;
+	/* devices taken for a stick */
+	INP_XARC_MATCHERS matchers;
+	/* opposite directions held at the same time */
+	STICK_SOCD_E socd;
+	/* in us, see CONFIG_CHORD_WINDOW_DEFAULT */
+	uint32_t chord_window;
+	/* chatter filter of the stick keys */
+	DEBOUNCE_PARAMS debounce;
+	/* autofire of the stick keys */
+	TURBO_PARAMS turbo;
+	/* time the emitted events carry */
+	UINPUT_BATCH_STAMP_E timestamps;
+	/* UINPUT_GPAD_DIRS_E per player of a stick */
+	uint8_t directions[CONFIG_PLAYERS_MAX];
+	/* used with -r */
+	RT_PARAMS rt;
+} CONFIG;
+
+void config_set_default(CONFIG* const config);
+int16_t config_load(CONFIG* const config, const char *path);
+
+#endif /* CONFIG_H_ */
@@ -0,0 +1,187 @@
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 2014, Florian Mueller                      */
+/* ======================================================================== */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "control.h"
+#include "logger.h"
+
+/* maximum number of words in one request */
+#define CONTROL_ARGS_MAX 8
+
+// declaration of supplementary functions  -------------------
+static void control_drop(CONTROL* const control, int client);
+static void control_execute(CONTROL* const control, CONTROL_CLIENT* const client,
+		char *line);
+
+// relizations ----------------------
+/* listens on a unix stream socket, only root may connect. Requests are
+ * lines of words, every answer ends with a line "OK" or "ERROR". */
+int16_t control_open(CONTROL* const control, const char *path,
+		const CONTROL_COMMAND *commands, uint16_t commandsnum, void *ctx) {
+	struct sockaddr_un addr;
+	int ctr;
+
+	memset(control, 0, sizeof(*control));
+	for (ctr = 0; ctr < CONTROL_CLIENTS_MAX; ctr++)
+		control->clients[ctr].fd = -1;
+	control->commands = commands;
+	control->commandsnum = commandsnum;
+	control->ctx = ctx;
+
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		printf("[control] Socket path %s is too long\n", path);
+		control->fd = -1;
+		return -1;
+	}
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+
+	control->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (control->fd < 0) {
+		printf("[control] Unable to create socket: %s\n", strerror(errno));
+		return -1;
+	}
+	/* a socket left behind by a crashed instance */
+	unlink(path);
+	if (bind(control->fd, (struct sockaddr *) &addr, sizeof(addr)) != 0
+			|| chmod(path, 0600) != 0 || listen(control->fd, 4) != 0) {
+		printf("[control] Unable to listen on %s: %s\n", path, strerror(errno));
+		close(control->fd);
+		control->fd = -1;
+		return -1;
+	}
+	strcpy(control->path, path);
+	return 0;
+}
+
+/* takes a new connection, returns its client slot or -1 */
+int16_t control_accept(CONTROL* const control) {
+	int fd, ctr;
+
+	fd = accept4(control->fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+	if (fd < 0)
+		return -1;
+	for (ctr = 0; ctr < CONTROL_CLIENTS_MAX; ctr++) {
+		if (control->clients[ctr].fd == -1)
+			break;
+	}
+	if (ctr == CONTROL_CLIENTS_MAX) {
+		close(fd);
+		return -1;
+	}
+	control->clients[ctr].fd = fd;
+	control->clients[ctr].len = 0;
+	return ctr;
+}
+
+/* answers all complete requests of a client, -1 once it is gone */
+int16_t control_read(CONTROL* const control, int client) {
+	CONTROL_CLIENT *cl = &control->clients[client];
+	char *start, *end;
+	ssize_t rd;
+
+	rd = read(cl->fd, cl->line + cl->len, sizeof(cl->line) - 1 - cl->len);
+	if (rd < 0 && (errno == EAGAIN || errno == EINTR))
+		return 0;
+	if (rd <= 0) {
+		control_drop(control, client);
+		return -1;
+	}
+	cl->len += rd;
+	cl->line[cl->len] = '\0';
+
+	start = cl->line;
+	while ((end = strchr(start, '\n')) != NULL) {
+		*end = '\0';
+		control_execute(control, cl, start);
+		start = end + 1;
+	}
+	cl->len -= start - cl->line;
+	memmove(cl->line, start, cl->len);
+	if (cl->len == sizeof(cl->line) - 1) {
+		/* no line end in sight */
+		control_drop(control, client);
+		return -1;
+	}
+	return 0;
+}
+
+void control_close(CONTROL* const control) {
+	int ctr;
+
+	if (control->fd < 0)
+		return;
+	for (ctr = 0; ctr < CONTROL_CLIENTS_MAX; ctr++) {
+		if (control->clients[ctr].fd != -1)
+			control_drop(control, ctr);
+	}
+	close(control->fd);
+	unlink(control->path);
+	control->fd = -1;
+}
+
+// supplementary functions -------------------
+
+static void control_drop(CONTROL* const control, int client) {
+	close(control->clients[client].fd);
+	control->clients[client].fd = -1;
+	control->clients[client].len = 0;
+}
+
+static void control_execute(CONTROL* const control, CONTROL_CLIENT* const client,
+		char *line) {
+	char reply[CONTROL_REPLY_MAX];
+	char *argv[CONTROL_ARGS_MAX];
+	char *saveptr;
+	int16_t result = -1;
+	int argc = 0;
+	int len = 0;
+	int ctr;
+
+	argv[argc] = strtok_r(line, " \t\r", &saveptr);
+	while (argv[argc] != NULL && argc < CONTROL_ARGS_MAX - 1)
+		argv[++argc] = strtok_r(NULL, " \t\r", &saveptr);
+	if (argc == 0)
+		return;
+
+	reply[0] = '\0';
+	for (ctr = 0; ctr < control->commandsnum; ctr++) {
+		if (strcmp(control->commands[ctr].name, argv[0]) == 0)
+			break;
+	}
+	if (ctr == control->commandsnum)
+		snprintf(reply, sizeof(reply) - 8, "unknown command %s\n", argv[0]);
+	else
+		result = control->commands[ctr].fn(control->ctx, argc, argv, reply,
+				sizeof(reply) - 8);
+
+	len = strlen(reply);
+	strcpy(reply + len, result == 0 ? "OK\n" : "ERROR\n");
+	/* answers are small, a client that does not read them loses them */
+	if (write(client->fd, reply, strlen(reply)) < 0 && errno != EAGAIN)
+		LOGGER(LOG_WARNING, "[control] Unable to answer: %s", strerror(errno));
+}
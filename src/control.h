@@ -0,0 +1,62 @@
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 2014, Florian Mueller                      */
+/* ======================================================================== */
+
+#ifndef CONTROL_H_
+#define CONTROL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* default path of the control socket */
+#define CONTROL_SOCKET "/run/xarcade2jstick.sock"
+#define CONTROL_CLIENTS_MAX 4
+/* longest request line and reply */
+#define CONTROL_LINE_MAX 256
+#define CONTROL_REPLY_MAX 4096
+
+/* writes the answer to reply, returns -1 if the request failed */
+typedef int16_t (*CONTROL_FN)(void *ctx, int argc, char *argv[], char *reply,
+		size_t len);
+
+typedef struct {
+	const char *name;
+	CONTROL_FN fn;
+} CONTROL_COMMAND;
+
+typedef struct {
+	int fd;
+	uint16_t len;
+	char line[CONTROL_LINE_MAX];
+} CONTROL_CLIENT;
+
+typedef struct {
+	int fd;
+	char path[108];
+	CONTROL_CLIENT clients[CONTROL_CLIENTS_MAX];
+	const CONTROL_COMMAND *commands;
+	uint16_t commandsnum;
+	void *ctx;
+} CONTROL;
+
+int16_t control_open(CONTROL* const control, const char *path,
+		const CONTROL_COMMAND *commands, uint16_t commandsnum, void *ctx);
+int16_t control_accept(CONTROL* const control);
+int16_t control_read(CONTROL* const control, int client);
+void control_close(CONTROL* const control);
+
+#endif /* CONTROL_H_ */
@@ -0,0 +1,104 @@
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 2014, Florian Mueller                      */
+/* ======================================================================== */
+
+#include <string.h>
+
+#include "debounce.h"
+
+// relizations ----------------------
+void debounce_set_default(DEBOUNCE_PARAMS* const params) {
+	int code;
+
+	params->mode = DEBOUNCE_OFF;
+	for (code = 0; code < KEY_CNT; code++)
+		params->window[code] = DEBOUNCE_WINDOW_DEFAULT;
+}
+
+/* forgets the key states, what is pending is dropped. The count stays. */
+void debounce_reset(DEBOUNCE* const db) {
+	uint64_t suppressed = db->suppressed;
+
+	memset(db, 0, sizeof(*db));
+	db->suppressed = suppressed;
+}
+
+/* runs a key event of the stick through the filter. Returns DEBOUNCE_PASS
+ * if it goes out now and DEBOUNCE_SCHEDULE if debounce_settle() has to
+ * run at due[code], either one dropping any earlier schedule for code. */
+int16_t debounce_key(DEBOUNCE* const db, const DEBOUNCE_PARAMS* const params,
+		uint16_t code, int32_t value, uint64_t time) {
+	uint64_t window;
+
+	if (code >= KEY_CNT)
+		return DEBOUNCE_PASS;
+	/* repeats follow the state that went out */
+	if (value == 2)
+		return db->out[code] == 1 ? DEBOUNCE_PASS : 0;
+
+	window = (uint64_t) params->window[code] * 1000;
+	db->raw[code] = value;
+	db->edge[code] = time;
+	if (params->mode == DEBOUNCE_OFF || window == 0) {
+		db->out[code] = value;
+		db->since[code] = time;
+		return DEBOUNCE_PASS;
+	}
+
+	if (params->mode == DEBOUNCE_DEFERRED) {
+		db->held[code]++;
+		db->due[code] = time + window;
+		return DEBOUNCE_SCHEDULE;
+	}
+
+	if (value != db->out[code]
+			&& (time < db->since[code] || time - db->since[code] >= window)) {
+		db->out[code] = value;
+		db->since[code] = time;
+		return DEBOUNCE_PASS;
+	}
+	/* within the window, settle once it is over */
+	db->held[code]++;
+	if (db->due[code] != 0)
+		return 0;
+	db->due[code] = db->since[code] + window;
+	return DEBOUNCE_SCHEDULE;
+}
+
+/* the window of code is over. Returns 1 and the state to send in value if
+ * the stick ended up in another state than the one that went out. */
+int16_t debounce_settle(DEBOUNCE* const db, uint16_t code, int32_t *value) {
+	uint64_t due;
+
+	if (code >= KEY_CNT || db->due[code] == 0)
+		return 0;
+	due = db->due[code];
+	db->due[code] = 0;
+
+	if (db->raw[code] == db->out[code]) {
+		db->suppressed += db->held[code];
+		db->held[code] = 0;
+		return 0;
+	}
+	/* the last of the held back edges goes out */
+	db->suppressed += db->held[code] - 1;
+	db->held[code] = 0;
+	db->out[code] = db->raw[code];
+	db->since[code] = due;
+	*value = db->out[code];
+	return 1;
+}
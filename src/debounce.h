@@ -0,0 +1,68 @@
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 2014, Florian Mueller                      */
+/* ======================================================================== */
+
+#ifndef DEBOUNCE_H_
+#define DEBOUNCE_H_
+
+#include <stdint.h>
+#include <linux/input.h>
+
+/* window of every key unless configured otherwise, in us */
+#define DEBOUNCE_WINDOW_DEFAULT 5000
+
+/* what debounce_key() asks the caller to do, or-ed together */
+#define DEBOUNCE_PASS 1		// translate the event now
+#define DEBOUNCE_SCHEDULE 2	// (re)schedule debounce_settle() at due[code]
+
+/* how a chattering switch is cleaned up */
+typedef enum {
+	DEBOUNCE_OFF = 0,
+	DEBOUNCE_EAGER = 1,	// the first edge goes out, the rest of the window is dropped
+	DEBOUNCE_DEFERRED = 2	// an edge goes out once the key was stable for the window
+} DEBOUNCE_MODE_E;
+
+typedef struct {
+	DEBOUNCE_MODE_E mode;
+	/* per key code in us, 0 lets the key through untouched */
+	uint32_t window[KEY_CNT];
+} DEBOUNCE_PARAMS;
+
+/* per stick state, all times are kernel timestamps in ns */
+typedef struct {
+	/* state passed on and state last reported by the stick */
+	int8_t out[KEY_CNT];
+	int8_t raw[KEY_CNT];
+	/* edges dropped since the last settle */
+	uint16_t held[KEY_CNT];
+	/* when out last changed, the window runs from there in eager mode */
+	uint64_t since[KEY_CNT];
+	/* the last edge reported by the stick */
+	uint64_t edge[KEY_CNT];
+	/* when debounce_settle() is due, 0 if it is not scheduled */
+	uint64_t due[KEY_CNT];
+	/* edges that never went out */
+	uint64_t suppressed;
+} DEBOUNCE;
+
+void debounce_set_default(DEBOUNCE_PARAMS* const params);
+void debounce_reset(DEBOUNCE* const db);
+int16_t debounce_key(DEBOUNCE* const db, const DEBOUNCE_PARAMS* const params,
+		uint16_t code, int32_t value, uint64_t time);
+int16_t debounce_settle(DEBOUNCE* const db, uint16_t code, int32_t *value);
+
+#endif /* DEBOUNCE_H_ */
@@ -0,0 +1,99 @@
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 2014, Florian Mueller                      */
+/* ======================================================================== */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+#include "input_hotplug.h"
+#include "input_xarcade.h"
+
+#define INP_HOTPLUG_MASK (IN_CREATE | IN_ATTRIB)
+
+// declaration of supplementary functions  -------------------
+static int16_t input_hotplug_watch(INP_HOTPLUG* const hotplug);
+
+// relizations ----------------------
+/* watches the input directory for new event nodes, or /dev until it exists */
+int16_t input_hotplug_open(INP_HOTPLUG* const hotplug) {
+	hotplug->wd = -1;
+	hotplug->dir_wd = -1;
+	hotplug->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (hotplug->fd < 0) {
+		printf("[input_hotplug] Unable to init inotify: %s\n", strerror(errno));
+		return -1;
+	}
+	if (input_hotplug_watch(hotplug) == 0)
+		return 0;
+
+	hotplug->dir_wd = inotify_add_watch(hotplug->fd, "/dev", IN_CREATE | IN_ONLYDIR);
+	if (hotplug->dir_wd < 0) {
+		printf("[input_hotplug] Unable to watch /dev: %s\n", strerror(errno));
+		return -1;
+	}
+	return 0;
+}
+
+int16_t input_hotplug_close(INP_HOTPLUG* const hotplug) {
+	int result = close(hotplug->fd);
+	hotplug->fd = -1;
+	return result;
+}
+
+/* calls fn for every event node that appeared or changed, returns how many */
+int16_t input_hotplug_read(INP_HOTPLUG* const hotplug, INP_HOTPLUG_FN fn,
+		void *ctx) {
+	char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+	char path[64];
+	const struct inotify_event *event;
+	int16_t found = 0;
+	ssize_t rd;
+	char *ptr;
+
+	while ((rd = read(hotplug->fd, buf, sizeof(buf))) > 0) {
+		for (ptr = buf; ptr < buf + rd; ptr += sizeof(*event) + event->len) {
+			event = (const struct inotify_event *) ptr;
+			if (event->len == 0)
+				continue;
+			if (event->wd == hotplug->dir_wd) {
+				if (strcmp(event->name, "input") == 0 && input_hotplug_watch(hotplug) == 0) {
+					inotify_rm_watch(hotplug->fd, hotplug->dir_wd);
+					hotplug->dir_wd = -1;
+				}
+				continue;
+			}
+			if (event->wd != hotplug->wd || strncmp(event->name, "event", 5) != 0)
+				continue;
+			snprintf(path, sizeof(path), INPUT_XARC_DIR "/%s", event->name);
+			fn(ctx, path);
+			found++;
+		}
+	}
+	if (rd < 0 && errno != EAGAIN)
+		return -errno;
+	return found;
+}
+
+// supplementary functions -------------------
+
+static int16_t input_hotplug_watch(INP_HOTPLUG* const hotplug) {
+	hotplug->wd = inotify_add_watch(hotplug->fd, INPUT_XARC_DIR, INP_HOTPLUG_MASK);
+	return hotplug->wd < 0 ? -1 : 0;
+}
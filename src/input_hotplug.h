@@ -0,0 +1,37 @@
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 2014, Florian Mueller                      */
+/* ======================================================================== */
+
+#ifndef INPUT_HOTPLUG_H_
+#define INPUT_HOTPLUG_H_
+
+#include <stdint.h>
+
+typedef void (*INP_HOTPLUG_FN)(void *ctx, const char *path);
+
+typedef struct {
+	int fd;
+	int wd;
+	int dir_wd;
+} INP_HOTPLUG;
+
+int16_t input_hotplug_open(INP_HOTPLUG* const hotplug);
+int16_t input_hotplug_close(INP_HOTPLUG* const hotplug);
+int16_t input_hotplug_read(INP_HOTPLUG* const hotplug, INP_HOTPLUG_FN fn,
+		void *ctx);
+
+#endif /* INPUT_HOTPLUG_H_ */
@@ -18,33 +18,159 @@
 
 #include <glob.h>
 #include <errno.h>
+#include <fnmatch.h>
+#include <stdlib.h>
+#include <time.h>
 #include "input_xarcade.h"
+#include "latency.h"
+#include "logger.h"
+
+#define KEYBIT_TEST(bits, code) ((bits)[(code) / 8] & (1 << ((code) % 8)))
+
+/* the sticks known so far */
+static const INP_XARC_MATCH input_xarcade_default[] = {
+	{ INPUT_XARC_MATCH_NAME, 0, 0, "XGaming X-Arcade" },
+	{ INPUT_XARC_MATCH_NAME, 0, 0, "Xgaming  X-Arcade" },
+	{ INPUT_XARC_MATCH_NAME, 0, 0, "XGaming X-Arcade 2" },
+	{ INPUT_XARC_MATCH_NAME, 0, 0, "Ultimarc" },
+	{ INPUT_XARC_MATCH_NAME, 0, 0, "XGaming USBAdapter" },
+	{ INPUT_XARC_MATCH_ID, 0xaa55, 0x0101, "" },
+	{ INPUT_XARC_MATCH_ID, 0xaa55, 0x0102, "" },
+};
 
 // declaration of supplementary functions  -------------------
-int findXarcadeDevice(void);
+static int16_t probeXarcadeDevice(const char *filename,
+		const INP_XARC_MATCHERS* const matchers);
+static int16_t readSysfsAttr(const char *node, const char *attr, char *buf,
+		size_t len);
+static int16_t matchXarcadeDevice(const INP_XARC_MATCHERS* const matchers,
+		const char *name, uint16_t vendor, uint16_t product);
+static int openXarcadeDevice(const char *filename,
+		const INP_XARC_MATCHERS* const matchers);
+static void filterXarcadeDevice(int fevdev);
+static int16_t resyncXarcadeDevice(INP_XARC_DEV* const xdev, int16_t count,
+		struct timeval time);
 
 // relizations ----------------------
-int16_t input_xarcade_open(INP_XARC_DEV* const xdev, INPUT_XARC_TYPE_E type) {
-	int result;
+/* allocates the read buffer, done once per unit */
+int16_t input_xarcade_init(INP_XARC_DEV* const xdev, uint16_t evlen) {
+	memset(xdev, 0, sizeof(*xdev));
+	xdev->fevdev = -1;
+	xdev->evlen = evlen;
+	xdev->ev = calloc(evlen + INPUT_XARC_EVS_RESYNC, sizeof(struct input_event));
+	return xdev->ev == NULL ? -1 : 0;
+}
 
-	// TODO check input parameter type
-	xdev->fevdev = findXarcadeDevice();
-	if (xdev->fevdev != -1) {
-		result = ioctl(xdev->fevdev, EVIOCGRAB, 1);
-		return result;
-	} else {
-		errno = 0;
+/* calls fn for every event node present, fn decides with input_xarcade_open() */
+int16_t input_xarcade_scan(INP_XARC_FOUND_FN fn, void *ctx) {
+	int ctr;
+	int rc;
+	glob_t pglob;
+
+	rc = glob(INPUT_XARC_DIR "/event*", 0, NULL, &pglob);
+	if (rc) {
+		printf("Failed to open event devices\n");
+		return -1;
+	}
+
+	for (ctr = 0; ctr < pglob.gl_pathc; ++ctr)
+		fn(ctx, pglob.gl_pathv[ctr]);
+	globfree(&pglob);
+	return ctr;
+}
+
+void input_xarcade_match_default(INP_XARC_MATCHERS* const matchers) {
+	memset(matchers, 0, sizeof(*matchers));
+	memcpy(matchers->match, input_xarcade_default, sizeof(input_xarcade_default));
+	matchers->count = sizeof(input_xarcade_default) / sizeof(input_xarcade_default[0]);
+}
+
+int16_t input_xarcade_match_add(INP_XARC_MATCHERS* const matchers,
+		INPUT_XARC_MATCH_E kind, const char *name, uint16_t vendor,
+		uint16_t product) {
+	INP_XARC_MATCH *match;
+
+	if (matchers->count == INPUT_XARC_MATCH_MAX)
+		return -1;
+	match = &matchers->match[matchers->count++];
+	match->kind = kind;
+	match->vendor = vendor;
+	match->product = product;
+	snprintf(match->name, sizeof(match->name), "%s", name ? name : "");
+	return 0;
+}
+
+/* opens and grabs path if it is a supported stick, errno is 0 if it is not
+ * and tells why otherwise. Without matchers any device at path is taken. */
+int16_t input_xarcade_open(INP_XARC_DEV* const xdev, const char *path,
+		const INP_XARC_MATCHERS* const matchers) {
+	xdev->fevdev = openXarcadeDevice(path, matchers);
+	if (xdev->fevdev == -1)
+		return -1;
+	snprintf(xdev->path, sizeof(xdev->path), "%s", path);
+	memset(xdev->phys, 0, sizeof(xdev->phys));
+	ioctl(xdev->fevdev, EVIOCGPHYS(sizeof(xdev->phys) - 1), xdev->phys);
+
+	if (ioctl(xdev->fevdev, EVIOCGRAB, 1) != 0) {
+		close(xdev->fevdev);
+		xdev->fevdev = -1;
 		return -1;
 	}
+	filterXarcadeDevice(xdev->fevdev);
+	return 0;
 }
 
+/* takes over a stick opened with input_xarcade_open into an initialised xdev */
+int16_t input_xarcade_attach(INP_XARC_DEV* const xdev,
+		const INP_XARC_DEV* const opened) {
+	xdev->fevdev = opened->fevdev;
+	memcpy(xdev->path, opened->path, sizeof(xdev->path));
+	memcpy(xdev->phys, opened->phys, sizeof(xdev->phys));
+	xdev->dropped = 0;
+
+	/* keys held while grabbing are released later, start from their state */
+	memset(xdev->keybits, 0, sizeof(xdev->keybits));
+	ioctl(xdev->fevdev, EVIOCGKEY(sizeof(xdev->keybits)), xdev->keybits);
+	return 0;
+}
+
+/* returns the number of events read, 0 if nothing was pending or -errno.
+ * Key events that do not change the key state are dropped, after a
+ * SYN_DROPPED the batch ends with the events needed to resync. */
 int16_t input_xarcade_read(INP_XARC_DEV* const xdev) {
+	struct input_event *event;
+	int16_t count = 0;
+	int ctr;
 	int rd;
 
-	rd = read(xdev->fevdev, xdev->ev, sizeof(struct input_event) * 64);
+	rd = read(xdev->fevdev, xdev->ev, sizeof(struct input_event) * xdev->evlen);
 	if (rd < 0)
-		return -errno;
-	return (rd / sizeof(struct input_event));
+		return errno == EAGAIN ? 0 : -errno;
+	rd /= sizeof(struct input_event);
+
+	for (ctr = 0; ctr < rd; ctr++) {
+		event = &xdev->ev[ctr];
+		if (event->type == EV_SYN && event->code == SYN_DROPPED) {
+			xdev->dropped = 1;
+			xdev->drops++;
+			continue;
+		}
+		if (xdev->dropped) {
+			/* the state queried now already covers the rest of the buffer */
+			if (event->type == EV_SYN && event->code == SYN_REPORT)
+				return resyncXarcadeDevice(xdev, count, event->time);
+			continue;
+		}
+		if (event->type == EV_KEY && event->code < KEY_CNT && event->value != 2) {
+			if (!KEYBIT_TEST(xdev->keybits, event->code) == !event->value)
+				continue;
+			xdev->keybits[event->code / 8] ^= 1 << (event->code % 8);
+		}
+		if (count != ctr)
+			xdev->ev[count] = *event;
+		count++;
+	}
+	return count;
 }
 
 int16_t input_xarcade_close(INP_XARC_DEV* const xdev) {
@@ -52,48 +178,173 @@ int16_t input_xarcade_close(INP_XARC_DEV* const xdev) {
 
 	result = ioctl(xdev->fevdev, EVIOCGRAB, 0);
 	close(xdev->fevdev);
+	xdev->fevdev = -1;
 	return result;
 }
 
+/* appends to the count events in xdev->ev the key changes that lead from
+ * the state handed out so far to keybits, closed by a SYN_REPORT */
+int16_t input_xarcade_resync(INP_XARC_DEV* const xdev, int16_t count,
+		struct timeval time, const uint8_t *keybits) {
+	struct input_event *event;
+	int code;
+
+	/* count is below evlen, so every change and the closing SYN_REPORT fit
+	 * into the INPUT_XARC_EVS_RESYNC slots behind the read */
+	for (code = 0; code < KEY_CNT; code++) {
+		if (!KEYBIT_TEST(keybits, code) == !KEYBIT_TEST(xdev->keybits, code))
+			continue;
+		event = &xdev->ev[count++];
+		event->time = time;
+		event->type = EV_KEY;
+		event->code = code;
+		event->value = KEYBIT_TEST(keybits, code) ? 1 : 0;
+		xdev->keybits[code / 8] ^= 1 << (code % 8);
+	}
+
+	event = &xdev->ev[count++];
+	event->time = time;
+	event->type = EV_SYN;
+	event->code = SYN_REPORT;
+	event->value = 0;
+	return count;
+}
+
 // supplementary functions -------------------
 
-int findXarcadeDevice(void) {
+/* decides by the sysfs attributes of a node, without opening it. Returns
+ * 1 for a match, 0 for none and -1 if sysfs does not tell. */
+static int16_t probeXarcadeDevice(const char *filename,
+		const INP_XARC_MATCHERS* const matchers) {
+	const char *node = strrchr(filename, '/');
 	char name[256];
-	char *filename;
-	int fevdev = -1;
+	char vendor[8];
+	char product[8];
+
+	node = node != NULL ? node + 1 : filename;
+	if (readSysfsAttr(node, "name", name, sizeof(name)) != 0
+			|| readSysfsAttr(node, "id/vendor", vendor, sizeof(vendor)) != 0
+			|| readSysfsAttr(node, "id/product", product, sizeof(product)) != 0)
+		return -1;
+	return matchXarcadeDevice(matchers, name, strtoul(vendor, NULL, 16),
+			strtoul(product, NULL, 16));
+}
+
+/* reads one line of INPUT_XARC_SYSFS/<node>/device/<attr> */
+static int16_t readSysfsAttr(const char *node, const char *attr, char *buf,
+		size_t len) {
+	char path[128];
+	ssize_t rd;
+	int fd;
+
+	snprintf(path, sizeof(path), INPUT_XARC_SYSFS "/%s/device/%s", node, attr);
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return -1;
+	rd = read(fd, buf, len - 1);
+	close(fd);
+	if (rd < 0)
+		return -1;
+	buf[rd] = '\0';
+	buf[strcspn(buf, "\n")] = '\0';
+	return 0;
+}
+
+static int16_t matchXarcadeDevice(const INP_XARC_MATCHERS* const matchers,
+		const char *name, uint16_t vendor, uint16_t product) {
+	const INP_XARC_MATCH *match;
 	int ctr;
-	int rc;
-	glob_t pglob;
 
-	rc = glob("/dev/input/event*", 0, NULL, &pglob);
-	if (rc) {
-		printf("Failed to open event devices\n");
+	for (ctr = 0; ctr < matchers->count; ctr++) {
+		match = &matchers->match[ctr];
+		if (match->kind == INPUT_XARC_MATCH_NAME
+				? fnmatch(match->name, name, 0) == 0
+				: match->vendor == vendor && match->product == product)
+			return 1;
+	}
+	return 0;
+}
+
+/* opens filename if it is a supported stick, -1 otherwise with errno 0 for
+ * devices the matchers turned down. Only nodes that sysfs names as a match
+ * are opened, without sysfs the name and id are asked from the device. */
+static int openXarcadeDevice(const char *filename,
+		const INP_XARC_MATCHERS* const matchers) {
+	struct input_id id;
+	char name[256];
+	int16_t probe;
+	int fevdev, err;
+
+	probe = matchers != NULL ? probeXarcadeDevice(filename, matchers) : 1;
+	if (probe == 0) {
+		errno = 0;
 		return -1;
 	}
 
-	for (ctr = 0; ctr < pglob.gl_pathc; ++ctr) {
-		filename = pglob.gl_pathv[ctr];
-		fevdev = open(filename, O_RDONLY);
-		if (fevdev == -1) {
-			printf("Failed to open event device %s.\n", filename);
-			continue;
-		}
+	fevdev = open(filename, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+	if (fevdev == -1) {
+		err = errno;
+		LOGGER(LOG_WARNING, "Failed to open event device %s.", filename);
+		errno = err;
+		return -1;
+	}
 
-		ioctl(fevdev, EVIOCGNAME(sizeof(name)), name);
-		if ((strcmp(name, "XGaming X-Arcade") == 0)
-            || (strcmp(name, "Xgaming  X-Arcade") == 0)
-            || (strcmp(name, "XGaming X-Arcade 2") == 0)
-		    || (strcmp(name, "Ultimarc") == 0)
-		    || (strcmp(name, "XGaming USBAdapter") == 0)) {
-			printf("Found %s (%s)\n", filename, name);
-			break;
-		} else {
+	memset(name, 0, sizeof(name));
+	memset(&id, 0, sizeof(id));
+	ioctl(fevdev, EVIOCGNAME(sizeof(name) - 1), name);
+	if (probe < 0) {
+		ioctl(fevdev, EVIOCGID, &id);
+		if (!matchXarcadeDevice(matchers, name, id.vendor, id.product)) {
 			close(fevdev);
-			fevdev = -1;
+			errno = 0;
+			return -1;
 		}
 	}
-	globfree(&pglob);
-
+	LOGGER(LOG_INFO, "Found %s (%s)", filename, name);
 	return fevdev;
 }
 
+/* lets only EV_KEY and EV_SYN through and stamps them with CLOCK_MONOTONIC */
+static void filterXarcadeDevice(int fevdev) {
+	struct input_event ev[16];
+	int clk = LATENCY_CLOCK;
+#ifdef EVIOCSMASK
+	struct input_mask mask;
+	uint8_t codes = 0;
+	unsigned int type;
+
+	/* an empty mask filters every code of a type, older kernels just keep
+	 * sending. Types without a mask are refused with EINVAL one by one, only
+	 * ENOTTY or a failing EV_REL, which every mask supports, end the loop. */
+	for (type = EV_KEY + 1; type < EV_CNT; type++) {
+		mask.type = type;
+		mask.codes_size = 0;
+		mask.codes_ptr = (uint64_t) (uintptr_t) &codes;
+		if (ioctl(fevdev, EVIOCSMASK, &mask) == 0)
+			continue;
+		if (errno == ENOTTY || type == EV_KEY + 1)
+			break;
+	}
+#endif
+
+	if (ioctl(fevdev, EVIOCSCLOCKID, &clk) < 0)
+		LOGGER(LOG_WARNING, "[input_xarcade] Unable to use CLOCK_MONOTONIC timestamps");
+
+	/* switching the clock may have queued a SYN_DROPPED, the state is read on attach */
+	while (read(fevdev, ev, sizeof(ev)) > 0)
+		;
+}
+
+/* appends the key changes between the state handed out and the real one */
+static int16_t resyncXarcadeDevice(INP_XARC_DEV* const xdev, int16_t count,
+		struct timeval time) {
+	uint8_t keybits[KEY_CNT / 8];
+
+	xdev->dropped = 0;
+	memset(keybits, 0, sizeof(keybits));
+	if (ioctl(xdev->fevdev, EVIOCGKEY(sizeof(keybits)), keybits) < 0)
+		return count;
+	LOGGER(LOG_WARNING, "[input_xarcade] Events dropped on %s, resyncing",
+			xdev->path);
+	return input_xarcade_resync(xdev, count, time, keybits);
+}
@@ -30,13 +30,67 @@ typedef enum {
 	INPUT_XARC_TYPE_TANKSTICK = 0
 } INPUT_XARC_TYPE_E;
 
+/* directory watched for plugged in devices */
+#define INPUT_XARC_DIR "/dev/input"
+/* maximum number of sticks served at the same time */
+#define INPUT_XARC_DEVS_MAX 8
+/* events fetched with one read unless configured otherwise */
+#define INPUT_XARC_EVS_DEFAULT 256
+/* room behind a read for a resync, every key plus the SYN_REPORT */
+#define INPUT_XARC_EVS_RESYNC (KEY_CNT + 1)
+
+/* attributes of an event node, read below /sys/class/input/<node>/device */
+#define INPUT_XARC_SYSFS "/sys/class/input"
+/* maximum number of device matchers */
+#define INPUT_XARC_MATCH_MAX 16
+
+typedef void (*INP_XARC_FOUND_FN)(void *ctx, const char *path);
+
+typedef enum {
+	INPUT_XARC_MATCH_NAME = 0,	// fnmatch() pattern on the device name
+	INPUT_XARC_MATCH_ID = 1		// USB vendor and product id
+} INPUT_XARC_MATCH_E;
+
+typedef struct {
+	uint8_t kind;
+	uint16_t vendor;
+	uint16_t product;
+	char name[80];
+} INP_XARC_MATCH;
+
+/* which devices are taken for a stick */
+typedef struct {
+	INP_XARC_MATCH match[INPUT_XARC_MATCH_MAX];
+	uint8_t count;
+} INP_XARC_MATCHERS;
+
 typedef struct {
 	int fevdev;
-	struct input_event ev[64];
+	char path[64];
+	char phys[64];
+	/* evlen events per read, INPUT_XARC_EVS_RESYNC more for a resync */
+	struct input_event *ev;
+	uint16_t evlen;
+	/* waiting for the SYN_REPORT that ends an overflow */
+	uint8_t dropped;
+	uint32_t drops;
+	/* key state as handed out so far, compared against EVIOCGKEY after drops */
+	uint8_t keybits[KEY_CNT / 8];
 } INP_XARC_DEV;
 
-int16_t input_xarcade_open(INP_XARC_DEV* const xdev, INPUT_XARC_TYPE_E type);
+int16_t input_xarcade_init(INP_XARC_DEV* const xdev, uint16_t evlen);
+int16_t input_xarcade_scan(INP_XARC_FOUND_FN fn, void *ctx);
+void input_xarcade_match_default(INP_XARC_MATCHERS* const matchers);
+int16_t input_xarcade_match_add(INP_XARC_MATCHERS* const matchers,
+		INPUT_XARC_MATCH_E kind, const char *name, uint16_t vendor,
+		uint16_t product);
+int16_t input_xarcade_open(INP_XARC_DEV* const xdev, const char *path,
+		const INP_XARC_MATCHERS* const matchers);
+int16_t input_xarcade_attach(INP_XARC_DEV* const xdev,
+		const INP_XARC_DEV* const opened);
 int16_t input_xarcade_close(INP_XARC_DEV* const xdev);
 int16_t input_xarcade_read(INP_XARC_DEV* const xdev);
+int16_t input_xarcade_resync(INP_XARC_DEV* const xdev, int16_t count,
+		struct timeval time, const uint8_t *keybits);
 
 #endif /* INPUT_XARCADE_H_ */
@@ -0,0 +1,225 @@
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 2014, Florian Mueller                      */
+/* ======================================================================== */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "keymap.h"
+
+typedef struct {
+	uint16_t source;
+	uint8_t action;
+	uint8_t player;
+	uint16_t code;
+	uint8_t xform;
+} KEYMAP_DEFAULT;
+
+/* the Tankstick layout, used when no configuration file is given */
+static const KEYMAP_DEFAULT keymap_default[] = {
+	/* ----------------  Player 1 controls ------------------- */
+	{ KEY_LEFTCTRL,  KEYMAP_ACTION_GPAD_KEY, 0, BTN_A,      KEYMAP_XFORM_BUTTON },
+	{ KEY_LEFTALT,   KEYMAP_ACTION_GPAD_KEY, 0, BTN_B,      KEYMAP_XFORM_BUTTON },
+	{ KEY_SPACE,     KEYMAP_ACTION_GPAD_KEY, 0, BTN_C,      KEYMAP_XFORM_BUTTON },
+	{ KEY_LEFTSHIFT, KEYMAP_ACTION_GPAD_KEY, 0, BTN_X,      KEYMAP_XFORM_BUTTON },
+	{ KEY_Z,         KEYMAP_ACTION_GPAD_KEY, 0, BTN_Y,      KEYMAP_XFORM_BUTTON },
+	{ KEY_X,         KEYMAP_ACTION_GPAD_KEY, 0, BTN_Z,      KEYMAP_XFORM_BUTTON },
+	{ KEY_C,         KEYMAP_ACTION_GPAD_KEY, 0, BTN_TL,     KEYMAP_XFORM_BUTTON },
+	{ KEY_5,         KEYMAP_ACTION_GPAD_KEY, 0, BTN_TR,     KEYMAP_XFORM_BUTTON },
+	{ KEY_1,         KEYMAP_ACTION_GPAD_KEY, 0, BTN_START,  KEYMAP_XFORM_BUTTON },
+	{ KEY_3,         KEYMAP_ACTION_GPAD_KEY, 0, BTN_SELECT, KEYMAP_XFORM_BUTTON },
+	{ KEY_KP4,       KEYMAP_ACTION_GPAD_ABS, 0, ABS_X,      KEYMAP_XFORM_AXIS_MIN },
+	{ KEY_LEFT,      KEYMAP_ACTION_GPAD_ABS, 0, ABS_X,      KEYMAP_XFORM_AXIS_MIN },
+	{ KEY_KP6,       KEYMAP_ACTION_GPAD_ABS, 0, ABS_X,      KEYMAP_XFORM_AXIS_MAX },
+	{ KEY_RIGHT,     KEYMAP_ACTION_GPAD_ABS, 0, ABS_X,      KEYMAP_XFORM_AXIS_MAX },
+	{ KEY_KP8,       KEYMAP_ACTION_GPAD_ABS, 0, ABS_Y,      KEYMAP_XFORM_AXIS_MIN },
+	{ KEY_UP,        KEYMAP_ACTION_GPAD_ABS, 0, ABS_Y,      KEYMAP_XFORM_AXIS_MIN },
+	{ KEY_KP2,       KEYMAP_ACTION_GPAD_ABS, 0, ABS_Y,      KEYMAP_XFORM_AXIS_MAX },
+	{ KEY_DOWN,      KEYMAP_ACTION_GPAD_ABS, 0, ABS_Y,      KEYMAP_XFORM_AXIS_MAX },
+
+	/* ----------------  Player 2 controls ------------------- */
+	{ KEY_A,          KEYMAP_ACTION_GPAD_KEY, 1, BTN_A,      KEYMAP_XFORM_BUTTON },
+	{ KEY_S,          KEYMAP_ACTION_GPAD_KEY, 1, BTN_B,      KEYMAP_XFORM_BUTTON },
+	{ KEY_Q,          KEYMAP_ACTION_GPAD_KEY, 1, BTN_C,      KEYMAP_XFORM_BUTTON },
+	{ KEY_W,          KEYMAP_ACTION_GPAD_KEY, 1, BTN_X,      KEYMAP_XFORM_BUTTON },
+	{ KEY_E,          KEYMAP_ACTION_GPAD_KEY, 1, BTN_Y,      KEYMAP_XFORM_BUTTON },
+	{ KEY_LEFTBRACE,  KEYMAP_ACTION_GPAD_KEY, 1, BTN_Z,      KEYMAP_XFORM_BUTTON },
+	{ KEY_RIGHTBRACE, KEYMAP_ACTION_GPAD_KEY, 1, BTN_TL,     KEYMAP_XFORM_BUTTON },
+	{ KEY_6,          KEYMAP_ACTION_GPAD_KEY, 1, BTN_TR,     KEYMAP_XFORM_BUTTON },
+	{ KEY_2,          KEYMAP_ACTION_GPAD_KEY, 1, BTN_START,  KEYMAP_XFORM_BUTTON },
+	{ KEY_4,          KEYMAP_ACTION_GPAD_KEY, 1, BTN_SELECT, KEYMAP_XFORM_BUTTON },
+	{ KEY_D,          KEYMAP_ACTION_GPAD_ABS, 1, ABS_X,      KEYMAP_XFORM_AXIS_MIN },
+	{ KEY_G,          KEYMAP_ACTION_GPAD_ABS, 1, ABS_X,      KEYMAP_XFORM_AXIS_MAX },
+	{ KEY_R,          KEYMAP_ACTION_GPAD_ABS, 1, ABS_Y,      KEYMAP_XFORM_AXIS_MIN },
+	{ KEY_F,          KEYMAP_ACTION_GPAD_ABS, 1, ABS_Y,      KEYMAP_XFORM_AXIS_MAX },
+};
+
+/* SELECT and START of player 2 together open the menu */
+static const uint16_t keymap_default_chord[] = { KEY_4, KEY_2 };
+
+/* output values for release, press and repeat of the source key */
+static const int32_t keymap_xform_values[][3] = {
+	[KEYMAP_XFORM_BUTTON]   = { 0, 1, 1 },
+	[KEYMAP_XFORM_AXIS_MIN] = { 2, 0, 0 }, // center or left/up
+	[KEYMAP_XFORM_AXIS_MAX] = { 2, 4, 4 }, // center or right/down
+	[KEYMAP_XFORM_TAP]      = { 1, 0, 0 }, // fires on key up
+};
+
+void keymap_clear(KEYMAP* const keymap) {
+	memset(keymap, 0, sizeof(*keymap));
+}
+
+void keymap_set_default(KEYMAP* const keymap) {
+	const KEYMAP_DEFAULT *def;
+	unsigned int ctr;
+
+	keymap_clear(keymap);
+	for (ctr = 0; ctr < sizeof(keymap_default) / sizeof(keymap_default[0]); ctr++) {
+		def = &keymap_default[ctr];
+		keymap_set(keymap, def->source, def->action, def->player, def->code,
+				def->xform);
+	}
+	keymap_chord_add(keymap, keymap_default_chord,
+			sizeof(keymap_default_chord) / sizeof(keymap_default_chord[0]),
+			KEYMAP_ACTION_KBD_KEY, 0, KEY_TAB, KEYMAP_XFORM_BUTTON);
+}
+
+int16_t keymap_set(KEYMAP* const keymap, uint16_t source,
+		KEYMAP_ACTION_E action, uint8_t player, uint16_t code,
+		KEYMAP_XFORM_E xform) {
+	KEYMAP_ENTRY *entry;
+
+	if (source >= KEYMAP_LEN || action >= KEYMAP_ACTION_CNT
+			|| xform > KEYMAP_XFORM_TAP
+			|| code >= (action == KEYMAP_ACTION_GPAD_ABS ? ABS_CNT : KEY_CNT))
+		return -1;
+
+	entry = &keymap->map[source];
+	entry->action = action;
+	entry->player = player;
+	entry->code = code;
+	memcpy(entry->value, keymap_xform_values[xform], sizeof(entry->value));
+	return 0;
+}
+
+/* lets source through to the virtual keyboard while it is unmapped */
+int16_t keymap_passthrough(KEYMAP* const keymap, uint16_t source,
+		uint8_t enable) {
+	if (source == KEY_RESERVED || source >= KEYMAP_PASSTHROUGH_LEN)
+		return -1;
+	if (enable)
+		keymap->passthrough[source / 8] |= 1 << (source % 8);
+	else
+		keymap->passthrough[source / 8] &= ~(1 << (source % 8));
+	return 0;
+}
+
+/* adds a chord of count keys, mapped like a key with keymap_set() */
+int16_t keymap_chord_add(KEYMAP* const keymap, const uint16_t *keys,
+		uint8_t count, KEYMAP_ACTION_E action, uint8_t player, uint16_t code,
+		KEYMAP_XFORM_E xform) {
+	KEYMAP_CHORD *chord;
+	uint8_t ctr;
+
+	if (keymap->chordsnum == KEYMAP_CHORDS_MAX || count < 2
+			|| count > KEYMAP_CHORD_KEYS || action >= KEYMAP_ACTION_CNT
+			|| xform > KEYMAP_XFORM_TAP
+			|| code >= (action == KEYMAP_ACTION_GPAD_ABS ? ABS_CNT : KEY_CNT))
+		return -1;
+	for (ctr = 0; ctr < count; ctr++) {
+		if (keys[ctr] >= KEYMAP_LEN)
+			return -1;
+	}
+
+	chord = &keymap->chords[keymap->chordsnum++];
+	memcpy(chord->keys, keys, count * sizeof(keys[0]));
+	chord->count = count;
+	chord->entry.action = action;
+	chord->entry.player = player;
+	chord->entry.code = code;
+	memcpy(chord->entry.value, keymap_xform_values[xform],
+			sizeof(chord->entry.value));
+	for (ctr = 0; ctr < count; ctr++)
+		keymap->chordkeys[keys[ctr] / 8] |= 1 << (keys[ctr] % 8);
+	return 0;
+}
+
+/* number of gamepads one stick needs for this keymap */
+uint8_t keymap_players(const KEYMAP* const keymap) {
+	const KEYMAP_ENTRY *entry;
+	uint8_t players = 1;
+	int ctr;
+
+	for (ctr = 0; ctr < KEYMAP_LEN + keymap->chordsnum; ctr++) {
+		entry = ctr < KEYMAP_LEN ? &keymap->map[ctr]
+				: &keymap->chords[ctr - KEYMAP_LEN].entry;
+		if (entry->action != KEYMAP_ACTION_NONE
+				&& entry->action < KEYMAP_ACTION_KBD_KEY
+				&& entry->player >= players)
+			players = entry->player + 1;
+	}
+	return players;
+}
+
+/* collects the keys and axes that player (or KEYMAP_PLAYER_KBD) receives */
+void keymap_targets(const KEYMAP* const keymap, uint8_t player,
+		KEYMAP_TARGETS* const targets) {
+	const KEYMAP_ENTRY *entry;
+	int ctr;
+
+	memset(targets, 0, sizeof(*targets));
+	if (player == KEYMAP_PLAYER_KBD)
+		memcpy(targets->keybits, keymap->passthrough, sizeof(keymap->passthrough));
+	for (ctr = 0; ctr < KEYMAP_LEN + keymap->chordsnum; ctr++) {
+		entry = ctr < KEYMAP_LEN ? &keymap->map[ctr]
+				: &keymap->chords[ctr - KEYMAP_LEN].entry;
+		switch (entry->action) {
+			case KEYMAP_ACTION_GPAD_KEY:
+			case KEYMAP_ACTION_GPAD_TAP:
+				if (entry->player == player)
+					targets->keybits[entry->code / 8] |= 1 << (entry->code % 8);
+				break;
+			case KEYMAP_ACTION_GPAD_ABS:
+				if (entry->player == player)
+					targets->absbits[entry->code / 8] |= 1 << (entry->code % 8);
+				break;
+			case KEYMAP_ACTION_KBD_KEY:
+			case KEYMAP_ACTION_KBD_TAP:
+				if (player == KEYMAP_PLAYER_KBD)
+					targets->keybits[entry->code / 8] |= 1 << (entry->code % 8);
+				break;
+			default:
+				break;
+		}
+	}
+}
+
+/* 1 if every code in need is also in have */
+int16_t keymap_targets_cover(const KEYMAP_TARGETS* const have,
+		const KEYMAP_TARGETS* const need) {
+	unsigned int ctr;
+
+	for (ctr = 0; ctr < sizeof(have->keybits); ctr++) {
+		if (need->keybits[ctr] & ~have->keybits[ctr])
+			return 0;
+	}
+	for (ctr = 0; ctr < sizeof(have->absbits); ctr++) {
+		if (need->absbits[ctr] & ~have->absbits[ctr])
+			return 0;
+	}
+	return 1;
+}
@@ -0,0 +1,107 @@
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 2014, Florian Mueller                      */
+/* ======================================================================== */
+
+#ifndef KEYMAP_H_
+#define KEYMAP_H_
+
+#include <stdint.h>
+#include <linux/input.h>
+
+/* the table is indexed directly by the evdev key code */
+#define KEYMAP_LEN KEY_CNT
+/* chords and the keys of one chord */
+#define KEYMAP_CHORDS_MAX 16
+#define KEYMAP_CHORD_KEYS 4
+/* codes below this are keyboard keys that may be passed through */
+#define KEYMAP_PASSTHROUGH_LEN BTN_MISC
+
+typedef enum {
+	KEYMAP_ACTION_NONE = 0,
+	KEYMAP_ACTION_GPAD_KEY = 1,
+	KEYMAP_ACTION_GPAD_ABS = 2,
+	KEYMAP_ACTION_GPAD_TAP = 3,
+	KEYMAP_ACTION_KBD_KEY = 4,
+	KEYMAP_ACTION_KBD_TAP = 5,
+	KEYMAP_ACTION_CNT
+} KEYMAP_ACTION_E;
+
+typedef enum {
+	KEYMAP_XFORM_BUTTON = 0,
+	KEYMAP_XFORM_AXIS_MIN = 1,
+	KEYMAP_XFORM_AXIS_MAX = 2,
+	KEYMAP_XFORM_TAP = 3
+} KEYMAP_XFORM_E;
+
+typedef struct {
+	uint8_t action;
+	uint8_t player;
+	uint16_t code;
+	/* output value indexed by the source value (release, press, repeat) */
+	int32_t value[3];
+} KEYMAP_ENTRY;
+
+/* keys held together act like one more key, mapped by entry */
+typedef struct {
+	uint16_t keys[KEYMAP_CHORD_KEYS];
+	uint8_t count;
+	KEYMAP_ENTRY entry;
+} KEYMAP_CHORD;
+
+typedef struct {
+	KEYMAP_ENTRY map[KEYMAP_LEN];
+	KEYMAP_CHORD chords[KEYMAP_CHORDS_MAX];
+	uint8_t chordsnum;
+	/* bit per key code that is part of a chord */
+	uint8_t chordkeys[KEYMAP_LEN / 8];
+	/* bit per unmapped key code that goes to the virtual keyboard as is */
+	uint8_t passthrough[KEYMAP_PASSTHROUGH_LEN / 8];
+} KEYMAP;
+
+#define KEYMAP_IS_CHORD_KEY(keymap, code) \
+	((keymap)->chordkeys[(code) / 8] & (1 << ((code) % 8)))
+#define KEYMAP_IS_PASSTHROUGH(keymap, code) ((code) < KEYMAP_PASSTHROUGH_LEN \
+	&& ((keymap)->passthrough[(code) / 8] & (1 << ((code) % 8))))
+
+/* player number that stands for the virtual keyboard in keymap_targets */
+#define KEYMAP_PLAYER_KBD 0xff
+
+/* the codes a mapping sends to one virtual device */
+typedef struct {
+	uint8_t keybits[KEY_CNT / 8];
+	uint8_t absbits[ABS_CNT / 8];
+} KEYMAP_TARGETS;
+
+#define KEYMAP_TARGET_TEST(bits, code) ((bits)[(code) / 8] & (1 << ((code) % 8)))
+
+void keymap_clear(KEYMAP* const keymap);
+void keymap_set_default(KEYMAP* const keymap);
+int16_t keymap_set(KEYMAP* const keymap, uint16_t source,
+		KEYMAP_ACTION_E action, uint8_t player, uint16_t code,
+		KEYMAP_XFORM_E xform);
+int16_t keymap_chord_add(KEYMAP* const keymap, const uint16_t *keys,
+		uint8_t count, KEYMAP_ACTION_E action, uint8_t player, uint16_t code,
+		KEYMAP_XFORM_E xform);
+int16_t keymap_passthrough(KEYMAP* const keymap, uint16_t source,
+		uint8_t enable);
+uint8_t keymap_players(const KEYMAP* const keymap);
+void keymap_targets(const KEYMAP* const keymap, uint8_t player,
+		KEYMAP_TARGETS* const targets);
+int16_t keymap_targets_cover(const KEYMAP_TARGETS* const have,
+		const KEYMAP_TARGETS* const need);
+
+#endif /* KEYMAP_H_ */
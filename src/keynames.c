@@ -0,0 +1,396 @@
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 2014, Florian Mueller                      */
+/* ======================================================================== */
+
+#include <stdlib.h>
+#include <string.h>
+#include <linux/input.h>
+
+#include "keynames.h"
+
+#define KEYNAME(type, name) { type, name, #name }
+
+typedef struct {
+	uint16_t type;
+	uint16_t code;
+	const char *name;
+} KEYNAME_ENTRY;
+
+/* event codes that may be used in the configuration, first name of a code is used for printing */
+static const KEYNAME_ENTRY keynames[] = {
+	KEYNAME(EV_KEY, KEY_RESERVED),
+	KEYNAME(EV_KEY, KEY_ESC),
+	KEYNAME(EV_KEY, KEY_1),
+	KEYNAME(EV_KEY, KEY_2),
+	KEYNAME(EV_KEY, KEY_3),
+	KEYNAME(EV_KEY, KEY_4),
+	KEYNAME(EV_KEY, KEY_5),
+	KEYNAME(EV_KEY, KEY_6),
+	KEYNAME(EV_KEY, KEY_7),
+	KEYNAME(EV_KEY, KEY_8),
+	KEYNAME(EV_KEY, KEY_9),
+	KEYNAME(EV_KEY, KEY_0),
+	KEYNAME(EV_KEY, KEY_MINUS),
+	KEYNAME(EV_KEY, KEY_EQUAL),
+	KEYNAME(EV_KEY, KEY_BACKSPACE),
+	KEYNAME(EV_KEY, KEY_TAB),
+	KEYNAME(EV_KEY, KEY_Q),
+	KEYNAME(EV_KEY, KEY_W),
+	KEYNAME(EV_KEY, KEY_E),
+	KEYNAME(EV_KEY, KEY_R),
+	KEYNAME(EV_KEY, KEY_T),
+	KEYNAME(EV_KEY, KEY_Y),
+	KEYNAME(EV_KEY, KEY_U),
+	KEYNAME(EV_KEY, KEY_I),
+	KEYNAME(EV_KEY, KEY_O),
+	KEYNAME(EV_KEY, KEY_P),
+	KEYNAME(EV_KEY, KEY_LEFTBRACE),
+	KEYNAME(EV_KEY, KEY_RIGHTBRACE),
+	KEYNAME(EV_KEY, KEY_ENTER),
+	KEYNAME(EV_KEY, KEY_LEFTCTRL),
+	KEYNAME(EV_KEY, KEY_A),
+	KEYNAME(EV_KEY, KEY_S),
+	KEYNAME(EV_KEY, KEY_D),
+	KEYNAME(EV_KEY, KEY_F),
+	KEYNAME(EV_KEY, KEY_G),
+	KEYNAME(EV_KEY, KEY_H),
+	KEYNAME(EV_KEY, KEY_J),
+	KEYNAME(EV_KEY, KEY_K),
+	KEYNAME(EV_KEY, KEY_L),
+	KEYNAME(EV_KEY, KEY_SEMICOLON),
+	KEYNAME(EV_KEY, KEY_APOSTROPHE),
+	KEYNAME(EV_KEY, KEY_GRAVE),
+	KEYNAME(EV_KEY, KEY_LEFTSHIFT),
+	KEYNAME(EV_KEY, KEY_BACKSLASH),
+	KEYNAME(EV_KEY, KEY_Z),
+	KEYNAME(EV_KEY, KEY_X),
+	KEYNAME(EV_KEY, KEY_C),
+	KEYNAME(EV_KEY, KEY_V),
+	KEYNAME(EV_KEY, KEY_B),
+	KEYNAME(EV_KEY, KEY_N),
+	KEYNAME(EV_KEY, KEY_M),
+	KEYNAME(EV_KEY, KEY_COMMA),
+	KEYNAME(EV_KEY, KEY_DOT),
+	KEYNAME(EV_KEY, KEY_SLASH),
+	KEYNAME(EV_KEY, KEY_RIGHTSHIFT),
+	KEYNAME(EV_KEY, KEY_KPASTERISK),
+	KEYNAME(EV_KEY, KEY_LEFTALT),
+	KEYNAME(EV_KEY, KEY_SPACE),
+	KEYNAME(EV_KEY, KEY_CAPSLOCK),
+	KEYNAME(EV_KEY, KEY_F1),
+	KEYNAME(EV_KEY, KEY_F2),
+	KEYNAME(EV_KEY, KEY_F3),
+	KEYNAME(EV_KEY, KEY_F4),
+	KEYNAME(EV_KEY, KEY_F5),
+	KEYNAME(EV_KEY, KEY_F6),
+	KEYNAME(EV_KEY, KEY_F7),
+	KEYNAME(EV_KEY, KEY_F8),
+	KEYNAME(EV_KEY, KEY_F9),
+	KEYNAME(EV_KEY, KEY_F10),
+	KEYNAME(EV_KEY, KEY_NUMLOCK),
+	KEYNAME(EV_KEY, KEY_SCROLLLOCK),
+	KEYNAME(EV_KEY, KEY_KP7),
+	KEYNAME(EV_KEY, KEY_KP8),
+	KEYNAME(EV_KEY, KEY_KP9),
+	KEYNAME(EV_KEY, KEY_KPMINUS),
+	KEYNAME(EV_KEY, KEY_KP4),
+	KEYNAME(EV_KEY, KEY_KP5),
+	KEYNAME(EV_KEY, KEY_KP6),
+	KEYNAME(EV_KEY, KEY_KPPLUS),
+	KEYNAME(EV_KEY, KEY_KP1),
+	KEYNAME(EV_KEY, KEY_KP2),
+	KEYNAME(EV_KEY, KEY_KP3),
+	KEYNAME(EV_KEY, KEY_KP0),
+	KEYNAME(EV_KEY, KEY_KPDOT),
+	KEYNAME(EV_KEY, KEY_ZENKAKUHANKAKU),
+	KEYNAME(EV_KEY, KEY_102ND),
+	KEYNAME(EV_KEY, KEY_F11),
+	KEYNAME(EV_KEY, KEY_F12),
+	KEYNAME(EV_KEY, KEY_RO),
+	KEYNAME(EV_KEY, KEY_KATAKANA),
+	KEYNAME(EV_KEY, KEY_HIRAGANA),
+	KEYNAME(EV_KEY, KEY_HENKAN),
+	KEYNAME(EV_KEY, KEY_KATAKANAHIRAGANA),
+	KEYNAME(EV_KEY, KEY_MUHENKAN),
+	KEYNAME(EV_KEY, KEY_KPJPCOMMA),
+	KEYNAME(EV_KEY, KEY_KPENTER),
+	KEYNAME(EV_KEY, KEY_RIGHTCTRL),
+	KEYNAME(EV_KEY, KEY_KPSLASH),
+	KEYNAME(EV_KEY, KEY_SYSRQ),
+	KEYNAME(EV_KEY, KEY_RIGHTALT),
+	KEYNAME(EV_KEY, KEY_LINEFEED),
+	KEYNAME(EV_KEY, KEY_HOME),
+	KEYNAME(EV_KEY, KEY_UP),
+	KEYNAME(EV_KEY, KEY_PAGEUP),
+	KEYNAME(EV_KEY, KEY_LEFT),
+	KEYNAME(EV_KEY, KEY_RIGHT),
+	KEYNAME(EV_KEY, KEY_END),
+	KEYNAME(EV_KEY, KEY_DOWN),
+	KEYNAME(EV_KEY, KEY_PAGEDOWN),
+	KEYNAME(EV_KEY, KEY_INSERT),
+	KEYNAME(EV_KEY, KEY_DELETE),
+	KEYNAME(EV_KEY, KEY_MACRO),
+	KEYNAME(EV_KEY, KEY_MUTE),
+	KEYNAME(EV_KEY, KEY_VOLUMEDOWN),
+	KEYNAME(EV_KEY, KEY_VOLUMEUP),
+	KEYNAME(EV_KEY, KEY_POWER),
+	KEYNAME(EV_KEY, KEY_KPEQUAL),
+	KEYNAME(EV_KEY, KEY_KPPLUSMINUS),
+	KEYNAME(EV_KEY, KEY_PAUSE),
+	KEYNAME(EV_KEY, KEY_SCALE),
+	KEYNAME(EV_KEY, KEY_KPCOMMA),
+	KEYNAME(EV_KEY, KEY_HANGEUL),
+	KEYNAME(EV_KEY, KEY_HANGUEL),
+	KEYNAME(EV_KEY, KEY_HANJA),
+	KEYNAME(EV_KEY, KEY_YEN),
+	KEYNAME(EV_KEY, KEY_LEFTMETA),
+	KEYNAME(EV_KEY, KEY_RIGHTMETA),
+	KEYNAME(EV_KEY, KEY_COMPOSE),
+	KEYNAME(EV_KEY, KEY_STOP),
+	KEYNAME(EV_KEY, KEY_AGAIN),
+	KEYNAME(EV_KEY, KEY_PROPS),
+	KEYNAME(EV_KEY, KEY_UNDO),
+	KEYNAME(EV_KEY, KEY_FRONT),
+	KEYNAME(EV_KEY, KEY_COPY),
+	KEYNAME(EV_KEY, KEY_OPEN),
+	KEYNAME(EV_KEY, KEY_PASTE),
+	KEYNAME(EV_KEY, KEY_FIND),
+	KEYNAME(EV_KEY, KEY_CUT),
+	KEYNAME(EV_KEY, KEY_HELP),
+	KEYNAME(EV_KEY, KEY_MENU),
+	KEYNAME(EV_KEY, KEY_CALC),
+	KEYNAME(EV_KEY, KEY_SETUP),
+	KEYNAME(EV_KEY, KEY_SLEEP),
+	KEYNAME(EV_KEY, KEY_WAKEUP),
+	KEYNAME(EV_KEY, KEY_FILE),
+	KEYNAME(EV_KEY, KEY_SENDFILE),
+	KEYNAME(EV_KEY, KEY_DELETEFILE),
+	KEYNAME(EV_KEY, KEY_XFER),
+	KEYNAME(EV_KEY, KEY_PROG1),
+	KEYNAME(EV_KEY, KEY_PROG2),
+	KEYNAME(EV_KEY, KEY_WWW),
+	KEYNAME(EV_KEY, KEY_MSDOS),
+	KEYNAME(EV_KEY, KEY_COFFEE),
+	KEYNAME(EV_KEY, KEY_SCREENLOCK),
+	KEYNAME(EV_KEY, KEY_ROTATE_DISPLAY),
+	KEYNAME(EV_KEY, KEY_DIRECTION),
+	KEYNAME(EV_KEY, KEY_CYCLEWINDOWS),
+	KEYNAME(EV_KEY, KEY_MAIL),
+	KEYNAME(EV_KEY, KEY_BOOKMARKS),
+	KEYNAME(EV_KEY, KEY_COMPUTER),
+	KEYNAME(EV_KEY, KEY_BACK),
+	KEYNAME(EV_KEY, KEY_FORWARD),
+	KEYNAME(EV_KEY, KEY_CLOSECD),
+	KEYNAME(EV_KEY, KEY_EJECTCD),
+	KEYNAME(EV_KEY, KEY_EJECTCLOSECD),
+	KEYNAME(EV_KEY, KEY_NEXTSONG),
+	KEYNAME(EV_KEY, KEY_PLAYPAUSE),
+	KEYNAME(EV_KEY, KEY_PREVIOUSSONG),
+	KEYNAME(EV_KEY, KEY_STOPCD),
+	KEYNAME(EV_KEY, KEY_RECORD),
+	KEYNAME(EV_KEY, KEY_REWIND),
+	KEYNAME(EV_KEY, KEY_PHONE),
+	KEYNAME(EV_KEY, KEY_ISO),
+	KEYNAME(EV_KEY, KEY_CONFIG),
+	KEYNAME(EV_KEY, KEY_HOMEPAGE),
+	KEYNAME(EV_KEY, KEY_REFRESH),
+	KEYNAME(EV_KEY, KEY_EXIT),
+	KEYNAME(EV_KEY, KEY_MOVE),
+	KEYNAME(EV_KEY, KEY_EDIT),
+	KEYNAME(EV_KEY, KEY_SCROLLUP),
+	KEYNAME(EV_KEY, KEY_SCROLLDOWN),
+	KEYNAME(EV_KEY, KEY_KPLEFTPAREN),
+	KEYNAME(EV_KEY, KEY_KPRIGHTPAREN),
+	KEYNAME(EV_KEY, KEY_NEW),
+	KEYNAME(EV_KEY, KEY_REDO),
+	KEYNAME(EV_KEY, KEY_F13),
+	KEYNAME(EV_KEY, KEY_F14),
+	KEYNAME(EV_KEY, KEY_F15),
+	KEYNAME(EV_KEY, KEY_F16),
+	KEYNAME(EV_KEY, KEY_F17),
+	KEYNAME(EV_KEY, KEY_F18),
+	KEYNAME(EV_KEY, KEY_F19),
+	KEYNAME(EV_KEY, KEY_F20),
+	KEYNAME(EV_KEY, KEY_F21),
+	KEYNAME(EV_KEY, KEY_F22),
+	KEYNAME(EV_KEY, KEY_F23),
+	KEYNAME(EV_KEY, KEY_F24),
+	KEYNAME(EV_KEY, KEY_PLAYCD),
+	KEYNAME(EV_KEY, KEY_PAUSECD),
+	KEYNAME(EV_KEY, KEY_PROG3),
+	KEYNAME(EV_KEY, KEY_PROG4),
+	KEYNAME(EV_KEY, KEY_ALL_APPLICATIONS),
+	KEYNAME(EV_KEY, KEY_DASHBOARD),
+	KEYNAME(EV_KEY, KEY_SUSPEND),
+	KEYNAME(EV_KEY, KEY_CLOSE),
+	KEYNAME(EV_KEY, KEY_PLAY),
+	KEYNAME(EV_KEY, KEY_FASTFORWARD),
+	KEYNAME(EV_KEY, KEY_BASSBOOST),
+	KEYNAME(EV_KEY, KEY_PRINT),
+	KEYNAME(EV_KEY, KEY_HP),
+	KEYNAME(EV_KEY, KEY_CAMERA),
+	KEYNAME(EV_KEY, KEY_SOUND),
+	KEYNAME(EV_KEY, KEY_QUESTION),
+	KEYNAME(EV_KEY, KEY_EMAIL),
+	KEYNAME(EV_KEY, KEY_CHAT),
+	KEYNAME(EV_KEY, KEY_SEARCH),
+	KEYNAME(EV_KEY, KEY_CONNECT),
+	KEYNAME(EV_KEY, KEY_FINANCE),
+	KEYNAME(EV_KEY, KEY_SPORT),
+	KEYNAME(EV_KEY, KEY_SHOP),
+	KEYNAME(EV_KEY, KEY_ALTERASE),
+	KEYNAME(EV_KEY, KEY_CANCEL),
+	KEYNAME(EV_KEY, KEY_BRIGHTNESSDOWN),
+	KEYNAME(EV_KEY, KEY_BRIGHTNESSUP),
+	KEYNAME(EV_KEY, KEY_MEDIA),
+	KEYNAME(EV_KEY, KEY_SWITCHVIDEOMODE),
+	KEYNAME(EV_KEY, KEY_KBDILLUMTOGGLE),
+	KEYNAME(EV_KEY, KEY_KBDILLUMDOWN),
+	KEYNAME(EV_KEY, KEY_KBDILLUMUP),
+	KEYNAME(EV_KEY, KEY_SEND),
+	KEYNAME(EV_KEY, KEY_REPLY),
+	KEYNAME(EV_KEY, KEY_FORWARDMAIL),
+	KEYNAME(EV_KEY, KEY_SAVE),
+	KEYNAME(EV_KEY, KEY_DOCUMENTS),
+	KEYNAME(EV_KEY, KEY_BATTERY),
+	KEYNAME(EV_KEY, KEY_BLUETOOTH),
+	KEYNAME(EV_KEY, KEY_WLAN),
+	KEYNAME(EV_KEY, KEY_UWB),
+	KEYNAME(EV_KEY, KEY_UNKNOWN),
+	KEYNAME(EV_KEY, KEY_VIDEO_NEXT),
+	KEYNAME(EV_KEY, KEY_VIDEO_PREV),
+	KEYNAME(EV_KEY, KEY_BRIGHTNESS_CYCLE),
+	KEYNAME(EV_KEY, KEY_BRIGHTNESS_AUTO),
+	KEYNAME(EV_KEY, KEY_BRIGHTNESS_ZERO),
+	KEYNAME(EV_KEY, KEY_DISPLAY_OFF),
+	KEYNAME(EV_KEY, KEY_WWAN),
+	KEYNAME(EV_KEY, KEY_WIMAX),
+	KEYNAME(EV_KEY, KEY_RFKILL),
+	KEYNAME(EV_KEY, KEY_MICMUTE),
+	KEYNAME(EV_KEY, BTN_0),
+	KEYNAME(EV_KEY, BTN_1),
+	KEYNAME(EV_KEY, BTN_2),
+	KEYNAME(EV_KEY, BTN_3),
+	KEYNAME(EV_KEY, BTN_4),
+	KEYNAME(EV_KEY, BTN_5),
+	KEYNAME(EV_KEY, BTN_6),
+	KEYNAME(EV_KEY, BTN_7),
+	KEYNAME(EV_KEY, BTN_8),
+	KEYNAME(EV_KEY, BTN_9),
+	KEYNAME(EV_KEY, BTN_LEFT),
+	KEYNAME(EV_KEY, BTN_RIGHT),
+	KEYNAME(EV_KEY, BTN_MIDDLE),
+	KEYNAME(EV_KEY, BTN_SIDE),
+	KEYNAME(EV_KEY, BTN_EXTRA),
+	KEYNAME(EV_KEY, BTN_FORWARD),
+	KEYNAME(EV_KEY, BTN_BACK),
+	KEYNAME(EV_KEY, BTN_TASK),
+	KEYNAME(EV_KEY, BTN_TRIGGER),
+	KEYNAME(EV_KEY, BTN_THUMB),
+	KEYNAME(EV_KEY, BTN_THUMB2),
+	KEYNAME(EV_KEY, BTN_TOP),
+	KEYNAME(EV_KEY, BTN_TOP2),
+	KEYNAME(EV_KEY, BTN_PINKIE),
+	KEYNAME(EV_KEY, BTN_BASE),
+	KEYNAME(EV_KEY, BTN_BASE2),
+	KEYNAME(EV_KEY, BTN_BASE3),
+	KEYNAME(EV_KEY, BTN_BASE4),
+	KEYNAME(EV_KEY, BTN_BASE5),
+	KEYNAME(EV_KEY, BTN_BASE6),
+	KEYNAME(EV_KEY, BTN_DEAD),
+	KEYNAME(EV_KEY, BTN_SOUTH),
+	KEYNAME(EV_KEY, BTN_A),
+	KEYNAME(EV_KEY, BTN_EAST),
+	KEYNAME(EV_KEY, BTN_B),
+	KEYNAME(EV_KEY, BTN_C),
+	KEYNAME(EV_KEY, BTN_NORTH),
+	KEYNAME(EV_KEY, BTN_X),
+	KEYNAME(EV_KEY, BTN_WEST),
+	KEYNAME(EV_KEY, BTN_Y),
+	KEYNAME(EV_KEY, BTN_Z),
+	KEYNAME(EV_KEY, BTN_TL),
+	KEYNAME(EV_KEY, BTN_TR),
+	KEYNAME(EV_KEY, BTN_TL2),
+	KEYNAME(EV_KEY, BTN_TR2),
+	KEYNAME(EV_KEY, BTN_SELECT),
+	KEYNAME(EV_KEY, BTN_START),
+	KEYNAME(EV_KEY, BTN_MODE),
+	KEYNAME(EV_KEY, BTN_THUMBL),
+	KEYNAME(EV_KEY, BTN_THUMBR),
+	KEYNAME(EV_KEY, BTN_DPAD_UP),
+	KEYNAME(EV_KEY, BTN_DPAD_DOWN),
+	KEYNAME(EV_KEY, BTN_DPAD_LEFT),
+	KEYNAME(EV_KEY, BTN_DPAD_RIGHT),
+	KEYNAME(EV_KEY, BTN_TRIGGER_HAPPY1),
+	KEYNAME(EV_KEY, BTN_TRIGGER_HAPPY2),
+	KEYNAME(EV_KEY, BTN_TRIGGER_HAPPY3),
+	KEYNAME(EV_KEY, BTN_TRIGGER_HAPPY4),
+	KEYNAME(EV_KEY, BTN_TRIGGER_HAPPY5),
+	KEYNAME(EV_KEY, BTN_TRIGGER_HAPPY6),
+	KEYNAME(EV_KEY, BTN_TRIGGER_HAPPY7),
+	KEYNAME(EV_KEY, BTN_TRIGGER_HAPPY8),
+	KEYNAME(EV_KEY, BTN_TRIGGER_HAPPY9),
+	KEYNAME(EV_KEY, BTN_TRIGGER_HAPPY10),
+	KEYNAME(EV_KEY, BTN_TRIGGER_HAPPY11),
+	KEYNAME(EV_KEY, BTN_TRIGGER_HAPPY12),
+	KEYNAME(EV_KEY, BTN_TRIGGER_HAPPY13),
+	KEYNAME(EV_KEY, BTN_TRIGGER_HAPPY14),
+	KEYNAME(EV_KEY, BTN_TRIGGER_HAPPY15),
+	KEYNAME(EV_KEY, BTN_TRIGGER_HAPPY16),
+	KEYNAME(EV_ABS, ABS_X),
+	KEYNAME(EV_ABS, ABS_Y),
+	KEYNAME(EV_ABS, ABS_Z),
+	KEYNAME(EV_ABS, ABS_RX),
+	KEYNAME(EV_ABS, ABS_RY),
+	KEYNAME(EV_ABS, ABS_RZ),
+	KEYNAME(EV_ABS, ABS_THROTTLE),
+	KEYNAME(EV_ABS, ABS_RUDDER),
+	KEYNAME(EV_ABS, ABS_WHEEL),
+	KEYNAME(EV_ABS, ABS_GAS),
+	KEYNAME(EV_ABS, ABS_BRAKE),
+	KEYNAME(EV_ABS, ABS_HAT0X),
+	KEYNAME(EV_ABS, ABS_HAT0Y),
+	KEYNAME(EV_ABS, ABS_HAT1X),
+	KEYNAME(EV_ABS, ABS_HAT1Y),
+	KEYNAME(EV_ABS, ABS_HAT2X),
+	KEYNAME(EV_ABS, ABS_HAT2Y),
+	KEYNAME(EV_ABS, ABS_HAT3X),
+	KEYNAME(EV_ABS, ABS_HAT3Y),
+};
+
+#define KEYNAMES_LEN (sizeof(keynames) / sizeof(keynames[0]))
+
+/* resolves a symbolic or numeric event code, returns the event type or -1 */
+int16_t keynames_lookup(const char *name, uint16_t *code) {
+	unsigned long value;
+	char *end;
+	unsigned int ctr;
+
+	for (ctr = 0; ctr < KEYNAMES_LEN; ctr++) {
+		if (strcmp(keynames[ctr].name, name) == 0) {
+			*code = keynames[ctr].code;
+			return keynames[ctr].type;
+		}
+	}
+
+	/* plain numbers are taken as key codes */
+	value = strtoul(name, &end, 0);
+	if (*name == '\0' || *end != '\0' || value >= KEY_CNT)
+		return -1;
+	*code = value;
+	return EV_KEY;
+}
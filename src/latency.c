@@ -0,0 +1,116 @@
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 2014, Florian Mueller                      */
+/* ======================================================================== */
+
+#include <stdio.h>
+#include <time.h>
+
+#include "latency.h"
+
+// declaration of supplementary functions  -------------------
+static unsigned int latency_bucket(uint64_t ns);
+static uint64_t latency_bucket_top(unsigned int bucket);
+
+// relizations ----------------------
+void latency_record(LATENCY_HIST* const hist, uint64_t ns) {
+	atomic_fetch_add_explicit(&hist->buckets[latency_bucket(ns)], 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&hist->sum, ns, memory_order_relaxed);
+	if (ns > atomic_load_explicit(&hist->max, memory_order_relaxed))
+		atomic_store_explicit(&hist->max, ns, memory_order_relaxed);
+	/* released last, a reader seeing the count sees the bucket as well */
+	atomic_fetch_add_explicit(&hist->count, 1, memory_order_release);
+}
+
+/* percentiles are the upper bound of the bucket they fall into */
+void latency_stats(LATENCY_HIST* const hist, LATENCY_STATS* const stats) {
+	uint64_t seen = 0;
+	uint64_t bucket;
+	unsigned int ctr;
+
+	stats->count = atomic_load_explicit(&hist->count, memory_order_acquire);
+	stats->mean = stats->count ? atomic_load_explicit(&hist->sum, memory_order_relaxed) / stats->count : 0;
+	stats->max = atomic_load_explicit(&hist->max, memory_order_relaxed);
+	stats->p50 = 0;
+	stats->p99 = 0;
+	if (stats->count == 0)
+		return;
+
+	for (ctr = 0; ctr < LATENCY_BUCKETS; ctr++) {
+		bucket = atomic_load_explicit(&hist->buckets[ctr], memory_order_relaxed);
+		if (bucket == 0)
+			continue;
+		seen += bucket;
+		if (stats->p50 == 0 && seen * 2 >= stats->count)
+			stats->p50 = latency_bucket_top(ctr);
+		if (seen * 100 >= stats->count * 99) {
+			stats->p99 = latency_bucket_top(ctr);
+			break;
+		}
+	}
+	if (stats->p50 > stats->max)
+		stats->p50 = stats->max;
+	if (stats->p99 > stats->max)
+		stats->p99 = stats->max;
+}
+
+/* one line summary in microseconds */
+int latency_format(LATENCY_HIST* const hist, const char *name, char *buf,
+		size_t len) {
+	LATENCY_STATS stats;
+
+	latency_stats(hist, &stats);
+	return snprintf(buf, len, "%s: n=%llu mean=%.1fus p50=%.1fus p99=%.1fus max=%.1fus",
+			name, (unsigned long long) stats.count, stats.mean / 1000.0,
+			stats.p50 / 1000.0, stats.p99 / 1000.0, stats.max / 1000.0);
+}
+
+/* CLOCK_MONOTONIC, the clock the sticks stamp their events with */
+uint64_t latency_now() {
+	struct timespec ts;
+
+	clock_gettime(LATENCY_CLOCK, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+uint64_t latency_timeval_ns(const struct timeval *tv) {
+	return (uint64_t) tv->tv_sec * 1000000000ULL + (uint64_t) tv->tv_usec * 1000;
+}
+
+// supplementary functions -------------------
+
+static unsigned int latency_bucket(uint64_t ns) {
+	unsigned int octave;
+
+	if (ns < (1 << LATENCY_SUB_BITS))
+		return ns;
+	octave = 63 - __builtin_clzll(ns);
+	if (octave >= LATENCY_OCTAVES)
+		return LATENCY_BUCKETS - 1;
+	/* the bits below the leading one select the linear sub-bucket */
+	return ((octave - LATENCY_SUB_BITS + 1) << LATENCY_SUB_BITS)
+			| ((ns >> (octave - LATENCY_SUB_BITS)) & ((1 << LATENCY_SUB_BITS) - 1));
+}
+
+static uint64_t latency_bucket_top(unsigned int bucket) {
+	unsigned int octave = (bucket >> LATENCY_SUB_BITS);
+	uint64_t sub = bucket & ((1 << LATENCY_SUB_BITS) - 1);
+
+	if (octave == 0)
+		return bucket;
+	octave += LATENCY_SUB_BITS - 1;
+	return ((1ULL << LATENCY_SUB_BITS) + sub + 1) << (octave - LATENCY_SUB_BITS);
+}
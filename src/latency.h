@@ -0,0 +1,59 @@
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 2014, Florian Mueller                      */
+/* ======================================================================== */
+
+#ifndef LATENCY_H_
+#define LATENCY_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <sys/time.h>
+
+/* the clock of latency_now(), the timers and the stick stamps */
+#define LATENCY_CLOCK CLOCK_MONOTONIC
+
+/* every power of two of nanoseconds is split into this many buckets */
+#define LATENCY_SUB_BITS 2
+#define LATENCY_OCTAVES 40
+#define LATENCY_BUCKETS (LATENCY_OCTAVES << LATENCY_SUB_BITS)
+
+/* written by one thread, read lock-free by anyone */
+typedef struct {
+	atomic_uint_least32_t buckets[LATENCY_BUCKETS];
+	atomic_uint_least64_t count;
+	atomic_uint_least64_t sum;
+	atomic_uint_least64_t max;
+} LATENCY_HIST;
+
+typedef struct {
+	uint64_t count;
+	uint64_t mean;
+	uint64_t p50;
+	uint64_t p99;
+	uint64_t max;
+} LATENCY_STATS;
+
+void latency_record(LATENCY_HIST* const hist, uint64_t ns);
+void latency_stats(LATENCY_HIST* const hist, LATENCY_STATS* const stats);
+int latency_format(LATENCY_HIST* const hist, const char *name, char *buf,
+		size_t len);
+uint64_t latency_now();
+uint64_t latency_timeval_ns(const struct timeval *tv);
+
+#endif /* LATENCY_H_ */
@@ -0,0 +1,232 @@
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 2014, Florian Mueller                      */
+/* ======================================================================== */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "logger.h"
+#include "latency.h"
+
+typedef struct {
+	/* the position it holds next, see logger_write() */
+	atomic_uint_least32_t seq;
+	int level;
+	char text[LOGGER_LINE_MAX];
+} LOGGER_ENTRY;
+
+/* several threads write, only the drain thread reads */
+typedef struct {
+	_Alignas(64) atomic_uint_least32_t head;
+	_Alignas(64) uint32_t tail;
+	LOGGER_ENTRY entries[LOGGER_RING_LEN];
+	atomic_uint_least64_t suppressed;
+	atomic_uint_least64_t lost;
+	atomic_int running;
+	/* logger_write() calls between looking at running and committing */
+	atomic_int writers;
+	uint8_t syslog;
+	pthread_t thread;
+} LOGGER_RING;
+
+static LOGGER_RING logger;
+
+// declaration of supplementary functions  -------------------
+static int logger_admit(LOGGER_SITE* const site, uint32_t *suppressed);
+static void logger_emit(int level, const char *text);
+static void logger_flush();
+static void *logger_drain(void *arg);
+
+// relizations ----------------------
+/* hands the writing of messages to a thread of the lowest priority.
+ * Until then and after logger_stop() messages are written right away. */
+int16_t logger_start(uint8_t use_syslog) {
+	pthread_attr_t attr;
+	sigset_t all, old;
+	int result, ctr;
+
+	logger.syslog = use_syslog;
+	atomic_store(&logger.head, 0);
+	logger.tail = 0;
+	for (ctr = 0; ctr < LOGGER_RING_LEN; ctr++)
+		atomic_store(&logger.entries[ctr].seq, ctr);
+
+	pthread_attr_init(&attr);
+	pthread_attr_setstacksize(&attr, LOGGER_STACK_SIZE);
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &old);
+	atomic_store(&logger.running, 1);
+	result = pthread_create(&logger.thread, &attr, logger_drain, NULL);
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+	pthread_attr_destroy(&attr);
+	if (result != 0) {
+		atomic_store(&logger.running, 0);
+		printf("[logger] Unable to start the log thread: %s\n", strerror(result));
+		return -1;
+	}
+	return 0;
+}
+
+/* writes what is still queued, later messages go out right away. Writers
+ * that saw the thread running are waited for, their messages are in the
+ * ring once they are done. */
+void logger_stop() {
+	if (!atomic_exchange(&logger.running, 0))
+		return;
+	pthread_join(logger.thread, NULL);
+	while (atomic_load(&logger.writers) != 0)
+		sched_yield();
+	logger_flush();
+}
+
+void logger_write(LOGGER_SITE* const site, int level, const char *fmt, ...) {
+	char text[LOGGER_LINE_MAX];
+	LOGGER_ENTRY *entry;
+	uint32_t pos, suppressed;
+	int32_t diff;
+	size_t len;
+	va_list args;
+
+	if (!logger_admit(site, &suppressed))
+		return;
+
+	/* counted first, so logger_stop() either sees this call or this call
+	 * sees the thread gone */
+	atomic_fetch_add(&logger.writers, 1);
+	if (!atomic_load(&logger.running)) {
+		atomic_fetch_sub(&logger.writers, 1);
+		entry = NULL;
+	} else {
+		/* a slot is free for position pos once its seq has come round to it */
+		pos = atomic_load_explicit(&logger.head, memory_order_relaxed);
+		for (;;) {
+			entry = &logger.entries[pos % LOGGER_RING_LEN];
+			diff = (int32_t) (atomic_load_explicit(&entry->seq,
+					memory_order_acquire) - pos);
+			if (diff == 0 && atomic_compare_exchange_weak_explicit(&logger.head,
+					&pos, pos + 1, memory_order_relaxed, memory_order_relaxed))
+				break;
+			if (diff < 0) {
+				atomic_fetch_add(&logger.lost, 1);
+				if (site != NULL)
+					atomic_fetch_add(&site->suppressed, suppressed + 1);
+				atomic_fetch_sub(&logger.writers, 1);
+				return;
+			}
+			if (diff > 0)
+				pos = atomic_load_explicit(&logger.head, memory_order_relaxed);
+		}
+	}
+
+	va_start(args, fmt);
+	vsnprintf(entry != NULL ? entry->text : text, LOGGER_LINE_MAX, fmt, args);
+	va_end(args);
+	if (suppressed) {
+		len = strlen(entry != NULL ? entry->text : text);
+		snprintf((entry != NULL ? entry->text : text) + len, LOGGER_LINE_MAX - len,
+				" (%u similar messages suppressed)", suppressed);
+	}
+
+	if (entry == NULL) {
+		logger_emit(level, text);
+		return;
+	}
+	entry->level = level;
+	atomic_store_explicit(&entry->seq, pos + 1, memory_order_release);
+	atomic_fetch_sub(&logger.writers, 1);
+}
+
+/* messages held back by the rate limits since the start */
+uint64_t logger_suppressed() {
+	return atomic_load(&logger.suppressed);
+}
+
+/* messages dropped because the ring was full */
+uint64_t logger_lost() {
+	return atomic_load(&logger.lost);
+}
+
+// supplementary functions -------------------
+
+/* 1 if the site may log now, suppressed tells how many messages of the
+ * site were held back since the last one that went out. Without a site
+ * everything goes out. */
+static int logger_admit(LOGGER_SITE* const site, uint32_t *suppressed) {
+	uint64_t now, start;
+
+	*suppressed = 0;
+	if (site == NULL)
+		return 1;
+	now = latency_now();
+	start = atomic_load_explicit(&site->start, memory_order_relaxed);
+
+	if (now - start >= LOGGER_SITE_INTERVAL_NS
+			&& atomic_compare_exchange_strong(&site->start, &start, now))
+		atomic_store(&site->count, 0);
+	if (atomic_fetch_add(&site->count, 1) >= LOGGER_SITE_BURST) {
+		atomic_fetch_add(&site->suppressed, 1);
+		atomic_fetch_add(&logger.suppressed, 1);
+		return 0;
+	}
+	*suppressed = atomic_exchange(&site->suppressed, 0);
+	return 1;
+}
+
+static void logger_emit(int level, const char *text) {
+	printf("%s\n", text);
+	if (logger.syslog)
+		syslog(level, "%s", text);
+}
+
+/* writes every message that is complete, from the drain thread only */
+static void logger_flush() {
+	LOGGER_ENTRY *entry;
+	int written = 0;
+
+	for (;;) {
+		entry = &logger.entries[logger.tail % LOGGER_RING_LEN];
+		if (atomic_load_explicit(&entry->seq, memory_order_acquire)
+				!= logger.tail + 1)
+			break;
+		logger_emit(entry->level, entry->text);
+		atomic_store_explicit(&entry->seq, logger.tail + LOGGER_RING_LEN,
+				memory_order_release);
+		logger.tail++;
+		written++;
+	}
+	if (written)
+		fflush(stdout);
+}
+
+/* runs only when nothing else wants the CPU, even under -r */
+static void *logger_drain(void *arg) {
+	struct sched_param param = { .sched_priority = 0 };
+	struct timespec pause = { .tv_sec = 0, .tv_nsec = LOGGER_DRAIN_NS };
+
+	pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+	while (atomic_load(&logger.running)) {
+		logger_flush();
+		nanosleep(&pause, NULL);
+	}
+	return NULL;
+}
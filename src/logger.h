@@ -0,0 +1,63 @@
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 2014, Florian Mueller                      */
+/* ======================================================================== */
+
+#ifndef LOGGER_H_
+#define LOGGER_H_
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <syslog.h>
+
+/* messages waiting for the drain thread */
+#define LOGGER_RING_LEN 64
+#define LOGGER_LINE_MAX 160
+/* every call site may log this many messages per interval, the rest is
+ * counted and reported with the next message that gets through */
+#define LOGGER_SITE_BURST 5
+#define LOGGER_SITE_INTERVAL_NS 1000000000ULL
+/* how often the drain thread looks for messages */
+#define LOGGER_DRAIN_NS 50000000L
+/* stack of the drain thread, mlockall() of -r pins all of it */
+#define LOGGER_STACK_SIZE (64 * 1024)
+
+/* rate limit of one call site */
+typedef struct {
+	atomic_uint_least64_t start;
+	atomic_uint_least32_t count;
+	atomic_uint_least32_t suppressed;
+} LOGGER_SITE;
+
+/* queues a message with its own rate limit, level is a syslog level.
+ * Formats into a preallocated slot, never blocks and makes no system call
+ * while the drain thread is running. */
+#define LOGGER(level, ...) do { \
+	static LOGGER_SITE loggerSite_; \
+	logger_write(&loggerSite_, level, __VA_ARGS__); \
+} while (0)
+
+/* the same without a rate limit, for output somebody asked for */
+#define LOGGER_ALL(level, ...) logger_write(NULL, level, __VA_ARGS__)
+
+int16_t logger_start(uint8_t use_syslog);
+void logger_stop();
+void logger_write(LOGGER_SITE* const site, int level, const char *fmt, ...)
+		__attribute__((format(printf, 3, 4)));
+uint64_t logger_suppressed();
+uint64_t logger_lost();
+
+#endif /* LOGGER_H_ */
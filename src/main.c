@@ -27,45 +27,406 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/select.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/time.h>
 #include <termios.h>
 #include <signal.h>
 #include <time.h>
 #include <syslog.h>
+#include <getopt.h>
+#include <limits.h>
 
 #include "uinput_gamepad.h"
 #include "uinput_kbd.h"
 #include "input_xarcade.h"
+#include "timer_sched.h"
+#include "input_hotplug.h"
+#include "config.h"
+#include "latency.h"
+#include "logger.h"
+#include "translate.h"
+#include "trace.h"
+#include "replay.h"
+#include "rt.h"
+#include "control.h"
+#include "pipeline.h"
+#include "state_page.h"
 
 // TODO Extract all magic numbers and collect them as defines in at a central location
 
-#define GPADSNUM 2
+/* upper limit for the virtual gamepads of all sticks together */
+#define GPADS_MAX 16
+
+/* long options without a short form */
+enum {
+	OPT_RECORD = 256,
+	OPT_REPLAY,
+	OPT_LOOPS,
+	OPT_OUTPUT,
+	OPT_CONTROL,
+	OPT_STATE,
+	OPT_DEVICE,
+	OPT_THREADS,
+	OPT_COMPARE
+};
+
+static const struct option longOptions[] = {
+	{ "record", required_argument, NULL, OPT_RECORD },
+	{ "replay", required_argument, NULL, OPT_REPLAY },
+	{ "loops", required_argument, NULL, OPT_LOOPS },
+	{ "output", required_argument, NULL, OPT_OUTPUT },
+	{ "control", required_argument, NULL, OPT_CONTROL },
+	{ "state", required_argument, NULL, OPT_STATE },
+	{ "device", required_argument, NULL, OPT_DEVICE },
+	{ "threads", no_argument, NULL, OPT_THREADS },
+	{ "compare", no_argument, NULL, OPT_COMPARE },
+	{ NULL, 0, NULL, 0 }
+};
+
+/* what an epoll event belongs to, control connections use
+ * EPOLL_TAG_CLIENT + slot and sticks EPOLL_TAG_XARCADE + unit */
+enum {
+	EPOLL_TAG_TIMER = 0,
+	EPOLL_TAG_HOTPLUG = 1,
+	EPOLL_TAG_CONTROL = 2,
+	EPOLL_TAG_PIPELINE = 3,
+	EPOLL_TAG_CLIENT = 4,
+	EPOLL_TAG_XARCADE = EPOLL_TAG_CLIENT + CONTROL_CLIENTS_MAX
+};
+
+/* a physical stick and the gamepads it feeds */
+typedef struct {
+	INP_XARC_DEV xarcdev;
+	TRANSLATE_UNIT state;
+	/* reads the stick with --threads */
+	PIPELINE_READER reader;
+} XARCADE_UNIT;
 
 UINP_KBD_DEV uinp_kbd;
-UINP_GPAD_DEV uinp_gpads[GPADSNUM];
-INP_XARC_DEV xarcdev;
+UINP_GPAD_DEV *uinp_gpads;
+STICK *sticks;
+int gpadsnum = 0;
+/* codes the devices were created with, one per player of a unit and the
+ * keyboard last */
+KEYMAP_TARGETS *registered;
+/* startup times in ns: process start, virtual devices, ready to serve */
+uint64_t startTime, devicesTime, readyTime;
+XARCADE_UNIT units[INPUT_XARC_DEVS_MAX];
+int unitsnum = 1;
+TIMER_SCHED sched;
+INP_HOTPLUG hotplug;
+int epfd = -1;
+/* the active configuration and a spare one to load the next into */
+CONFIG configs[2];
+CONFIG *config = &configs[0];
+char configPath[PATH_MAX];
+CONTROL control = { .fd = -1 };
+STATE_PAGE_WRITER statePage = { .fd = -1 };
+volatile sig_atomic_t reloadConfig = 0;
+/* nodes given with --device, these are taken without matching */
+const char *devicePaths[INPUT_XARC_DEVS_MAX];
+int devicesnum = 0;
+TRANSLATE_CTX translator;
+TRACE recorder = { .fd = -1 };
+/* with --threads the sticks are read by threads of their own, woken
+ * through wakefd. They start once the process is set up for good. */
+int threaded = 0;
+int readersRunning = 0;
+int wakefd = -1;
+int stopfd = -1;
+volatile sig_atomic_t dumpStats = 0;
+/* SIGINT or SIGTERM, the main loop ends and tears down */
+volatile sig_atomic_t exitSignal = 0;
 int use_syslog = 0;
 
 #define SYSLOG(...) if (use_syslog == 1) { syslog(__VA_ARGS__); }
 
 static void teardown();
+static int16_t startReader(XARCADE_UNIT *unit);
 static void signal_handler(int signum);
+static void stats_handler(int signum);
+static void reload_handler(int signum);
+static void publishState();
+static int16_t controlStats(void *ctx, int argc, char *argv[], char *reply,
+		size_t len);
+static int16_t controlProfile(void *ctx, int argc, char *argv[], char *reply,
+		size_t len);
+static int16_t controlReload(void *ctx, int argc, char *argv[], char *reply,
+		size_t len);
+
+static const CONTROL_COMMAND controlCommands[] = {
+	{ "stats", controlStats },
+	{ "profile", controlProfile },
+	{ "reload", controlReload },
+};
+
+static void usage(const char *name) {
+	fprintf(stderr, "Usage: %s [-d] [-s] [-r] [-c config] [-n sticks] [--record file]\n"
+			"          [--output uinput|memory|file:path] [--control socket|none]\n"
+			"          [--state path|none] [--device path]... [--threads]\n"
+			"       %s [-r] [-c config] [-n sticks] --replay file [--loops n]\n"
+			"          [--output memory|file:path] [--threads|--compare]\n",
+			name, name);
+	exit(EXIT_FAILURE);
+}
+
+/* one line of the statistics per call, -1 once there are no more */
+static int statsLine(int idx, char *line, size_t len) {
+	UINP_BATCH *batch;
+	char name[32];
+	size_t pos;
+
+	if (idx <= gpadsnum) {
+		batch = idx < gpadsnum ? &uinp_gpads[idx].batch : &uinp_kbd.batch;
+		if (idx < gpadsnum)
+			snprintf(name, sizeof(name), "gamepad %d", idx + 1);
+		else
+			snprintf(name, sizeof(name), "keyboard");
+		pos = latency_format(&batch->latency, name, line, len);
+		if (pos < len)
+			snprintf(line + pos, len - pos, " sent=%llu",
+					(unsigned long long) batch->sent);
+	} else if (idx - gpadsnum - 1 < unitsnum) {
+		idx -= gpadsnum + 1;
+		snprintf(line, len, "unit %d: %s, %u overflows, %llu debounced, %llu stalls",
+				idx + 1,
+				units[idx].xarcdev.fevdev != -1 ? units[idx].xarcdev.path : "detached",
+				units[idx].xarcdev.drops,
+				(unsigned long long) units[idx].state.debounce.suppressed,
+				(unsigned long long) atomic_load(&units[idx].reader.ring.stalls));
+	} else if (idx == gpadsnum + 1 + unitsnum) {
+		latency_format(&translator.turbo_jitter, "turbo jitter", line, len);
+	} else if (idx == gpadsnum + 2 + unitsnum) {
+		snprintf(line, len, "log: %llu suppressed, %llu lost",
+				(unsigned long long) logger_suppressed(),
+				(unsigned long long) logger_lost());
+	} else if (idx == gpadsnum + 3 + unitsnum) {
+		snprintf(line, len, "startup: ready after %llu us, virtual devices %llu us",
+				(unsigned long long) (readyTime - startTime) / 1000,
+				(unsigned long long) devicesTime / 1000);
+	} else {
+		return -1;
+	}
+	return 0;
+}
+
+/* latency from stick event to uinput write for every virtual device, the
+ * log thread writes it out */
+static void printStats() {
+	char line[200];
+	int ctr;
+
+	for (ctr = 0; statsLine(ctr, line, sizeof(line)) == 0; ctr++)
+		LOGGER_ALL(LOG_NOTICE, "[Xarcade2Joystick] %s", line);
+}
+
+/* makes cfg the active configuration, settings that shape the devices
+ * stay as they were at startup */
+static void useConfig(CONFIG *cfg) {
+	int ctr;
+
+	config = cfg;
+	translator.keymap = &cfg->keymap;
+	translator.socd = cfg->socd;
+	translator.chord_window = cfg->chord_window;
+	translator.debounce = &cfg->debounce;
+	translator.turbo = &cfg->turbo;
+	for (ctr = 0; ctr < gpadsnum; ctr++)
+		uinp_gpads[ctr].batch.stamp = cfg->timestamps;
+	uinp_kbd.batch.stamp = cfg->timestamps;
+}
+
+/* loads path into the spare configuration and switches over. The main
+ * loop is single threaded, so this always happens between two batches. */
+static int16_t switchConfig(const char *path, char *reply, size_t len) {
+	CONFIG *next = config == &configs[0] ? &configs[1] : &configs[0];
+	KEYMAP_TARGETS targets;
+	int players, ctr;
+
+	config_set_default(next);
+	if (path[0] != '\0' && config_load(next, path) != 0) {
+		snprintf(reply, len, "invalid configuration %s\n", path);
+		return -1;
+	}
+	players = keymap_players(&next->keymap);
+	if (players > gpadsnum / unitsnum) {
+		snprintf(reply, len, "%s needs %d gamepads per stick, there are %d\n",
+				path, players, gpadsnum / unitsnum);
+		return -1;
+	}
+	for (ctr = 0; ctr <= gpadsnum / unitsnum; ctr++) {
+		keymap_targets(&next->keymap,
+				ctr < gpadsnum / unitsnum ? ctr : KEYMAP_PLAYER_KBD, &targets);
+		if (!keymap_targets_cover(&registered[ctr], &targets)) {
+			snprintf(reply, len, "%s sends codes the %s was not created with, "
+					"restart to use it\n", path,
+					ctr < gpadsnum / unitsnum ? "gamepad" : "keyboard");
+			return -1;
+		}
+	}
+
+	/* what is held now was pressed with the old mapping */
+	for (ctr = 0; ctr < unitsnum; ctr++)
+		translate_release_all(&translator, &units[ctr].state);
+	useConfig(next);
+	if (path != configPath)
+		snprintf(configPath, sizeof(configPath), "%s", path);
+
+	snprintf(reply, len, "using %s\n", path[0] != '\0' ? path : "built-in layout");
+	LOGGER(LOG_NOTICE, "[Xarcade2Joystick] Switched to %s",
+			path[0] != '\0' ? path : "built-in layout");
+	return 0;
+}
+
+static int epollAdd(int fd, uint32_t tag) {
+	struct epoll_event event;
+
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.u32 = tag;
+	return epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &event);
+}
+
+/* path as seen from the current directory, which daemon() leaves for / */
+static const char *absolutePath(const char *path, char *abs, size_t len) {
+	size_t cwd;
+
+	if (path == NULL || path[0] == '/' || getcwd(abs, len) == NULL)
+		return path;
+	cwd = strlen(abs);
+	if (snprintf(abs + cwd, len - cwd, "/%s", path) >= (int) (len - cwd))
+		return path;
+	return abs;
+}
 
-void outputKeyPress(short keyPad, int keyCode, int state) {
-	 uinput_gpad_write(&uinp_gpads[ keyPad ], keyCode, state, EV_KEY);
+/* a returning stick gets its old players back, a new one the first free unit */
+static XARCADE_UNIT *findFreeUnit(const char *phys) {
+	XARCADE_UNIT *unit = NULL;
+	int ctr;
+
+	for (ctr = 0; ctr < unitsnum; ctr++) {
+		if (units[ctr].xarcdev.fevdev != -1)
+			continue;
+		if (strcmp(units[ctr].xarcdev.phys, phys) == 0)
+			return &units[ctr];
+		if (unit == NULL || (unit->xarcdev.phys[0] != '\0'
+					&& units[ctr].xarcdev.phys[0] == '\0'))
+			unit = &units[ctr];
+	}
+	return unit;
+}
+
+static void attachDevice(void *ctx, const char *path) {
+	INP_XARC_DEV xarcdev;
+	XARCADE_UNIT *unit;
+	int ctr;
+
+	for (ctr = 0; ctr < unitsnum; ctr++) {
+		if (units[ctr].xarcdev.fevdev != -1
+				&& strcmp(units[ctr].xarcdev.path, path) == 0)
+			return;
+	}
+	for (ctr = 0; ctr < devicesnum && strcmp(devicePaths[ctr], path) != 0; ctr++)
+		;
+	if (devicesnum > 0 && ctr == devicesnum)
+		return;
+	if (input_xarcade_open(&xarcdev, path,
+			devicesnum > 0 ? NULL : &config->matchers) != 0) {
+		if (errno != 0)
+			LOGGER(LOG_WARNING, "Failed to get exclusive access to %s: %d (%s)",
+					path, errno, strerror(errno));
+		return;
+	}
+
+	unit = findFreeUnit(xarcdev.phys);
+	if (unit == NULL) {
+		LOGGER(LOG_WARNING, "[Xarcade2Joystick] No free unit for %s, ignored", path);
+		input_xarcade_close(&xarcdev);
+		return;
+	}
+	input_xarcade_attach(&unit->xarcdev, &xarcdev);
+	if (!threaded)
+		epollAdd(unit->xarcdev.fevdev, EPOLL_TAG_XARCADE + (unit - units));
+	else if (readersRunning && startReader(unit) != 0)
+		return;
+	LOGGER(LOG_NOTICE, "[Xarcade2Joystick] Attached %s as players %d-%d", path,
+			unit->state.playerOffset + 1, unit->state.playerOffset + gpadsnum / unitsnum);
+}
+
+/* the virtual gamepads stay, so the emulator keeps its joysticks */
+static void detachDevice(XARCADE_UNIT *unit) {
+	if (!threaded)
+		epoll_ctl(epfd, EPOLL_CTL_DEL, unit->xarcdev.fevdev, NULL);
+	input_xarcade_close(&unit->xarcdev);
+	translate_release_all(&translator, &unit->state);
+	LOGGER(LOG_NOTICE, "[Xarcade2Joystick] Detached %s, waiting for it to return",
+			unit->xarcdev.path);
+}
+
+/* a stick that cannot get its thread is not taken */
+static int16_t startReader(XARCADE_UNIT *unit) {
+	if (pipeline_reader_start(&unit->reader, &unit->xarcdev, unit - units,
+			wakefd, stopfd, recorder.fd != -1 ? &recorder : NULL) == 0)
+		return 0;
+	input_xarcade_close(&unit->xarcdev);
+	return -1;
 }
 
-void outputAxisChange(short keyPad, int axisCode, int value) {
-	 uinput_gpad_write(&uinp_gpads[ keyPad ], axisCode, value, EV_ABS);
+/* translates what the reader threads have queued. A reader that lost its
+ * stick has ended, it is joined before the stick is closed. */
+static void drainReaders() {
+	const PIPELINE_SLOT *slot;
+	XARCADE_UNIT *unit;
+	uint64_t count;
+	int ctr;
+
+	if (read(wakefd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+		return;
+	for (ctr = 0; ctr < unitsnum; ctr++) {
+		unit = &units[ctr];
+		while (unit->reader.running
+				&& (slot = pipeline_ring_peek(&unit->reader.ring)) != NULL) {
+			if (slot->kind == PIPELINE_KIND_CLOSED) {
+				pipeline_ring_release(&unit->reader.ring);
+				pipeline_reader_join(&unit->reader);
+				detachDevice(unit);
+				break;
+			}
+			/* a long read spans several slots but goes out in one write */
+			translate_queue_events(&translator, &unit->state, slot->ev,
+					slot->count);
+			if (!slot->more)
+				translate_flush(&translator);
+			pipeline_ring_release(&unit->reader.ring);
+		}
+	}
 }
 
 int main(int argc, char* argv[]) {
-	int rd, ctr, combo = 0;
-	char keyStates[256];
+	int rd, ctr, nev;
+	int playersPerUnit;
+	unsigned long optunits = 0;
+	XARCADE_UNIT *unit;
+	uint64_t devicesStart;
+	sigset_t signals, waitMask;
 
 	int detach = 0;
+	int realtime = 0;
+	const char *config_file = NULL;
+	const char *record_file = NULL;
+	const char *replay_file = NULL;
+	unsigned long loops = 1;
+	const OUTPUT_BACKEND *output = NULL;
+	const char *output_arg = NULL;
+	const char *control_path = CONTROL_SOCKET;
+	const char *state_path = STATE_PAGE_PATH;
+	char controlAbs[PATH_MAX], stateAbs[PATH_MAX];
+	int compare = 0;
 	int opt;
-	while ((opt = getopt(argc, argv, "+ds")) != -1) {
+
+	startTime = latency_now();
+	while ((opt = getopt_long(argc, argv, "+dsrc:n:", longOptions, NULL)) != -1) {
 		switch (opt) {
 			case 'd':
 				detach = 1;
@@ -73,36 +434,185 @@ int main(int argc, char* argv[]) {
 			case 's':
 				use_syslog = 1;
 				break;
+			case 'r':
+				realtime = 1;
+				break;
+			case 'c':
+				config_file = optarg;
+				break;
+			case 'n':
+				optunits = strtoul(optarg, NULL, 10);
+				if (optunits < 1 || optunits > INPUT_XARC_DEVS_MAX)
+					usage(argv[0]);
+				break;
+			case OPT_RECORD:
+				record_file = optarg;
+				break;
+			case OPT_REPLAY:
+				replay_file = optarg;
+				break;
+			case OPT_LOOPS:
+				loops = strtoul(optarg, NULL, 10);
+				if (loops < 1)
+					usage(argv[0]);
+				break;
+			case OPT_OUTPUT:
+				output = output_find(optarg, &output_arg);
+				if (output == NULL)
+					usage(argv[0]);
+				break;
+			case OPT_DEVICE:
+				if (devicesnum == INPUT_XARC_DEVS_MAX)
+					usage(argv[0]);
+				devicePaths[devicesnum++] = optarg;
+				break;
+			case OPT_CONTROL:
+				control_path = strcmp(optarg, "none") == 0 ? NULL : optarg;
+				break;
+			case OPT_STATE:
+				state_path = strcmp(optarg, "none") == 0 ? NULL : optarg;
+				break;
+			case OPT_THREADS:
+				threaded = 1;
+				break;
+			case OPT_COMPARE:
+				compare = 1;
+				break;
 			default:
-				fprintf(stderr, "Usage: %s [-d] [-s]\n", argv[0]);
-				exit(EXIT_FAILURE);
+				usage(argv[0]);
 				break;
 		}
 	}
 
+	config_set_default(config);
+	if (config_file == NULL && access(CONFIG_FILE, R_OK) == 0)
+		config_file = CONFIG_FILE;
+	if (config_file != NULL) {
+		if (config_load(config, config_file) != 0) {
+			fprintf(stderr, "Invalid configuration %s\n", config_file);
+			exit(EXIT_FAILURE);
+		}
+		printf("[Xarcade2Joystick] Loaded configuration %s\n", config_file);
+	}
+	/* reloads, the socket and the page come after daemon() */
+	if (config_file != NULL && absolutePath(config_file, configPath,
+			sizeof(configPath)) != configPath)
+		snprintf(configPath, sizeof(configPath), "%s", config_file);
+	control_path = absolutePath(control_path, controlAbs, sizeof(controlAbs));
+	state_path = absolutePath(state_path, stateAbs, sizeof(stateAbs));
+
+	unitsnum = optunits ? optunits : config->units;
+	if (optunits == 0 && devicesnum > unitsnum)
+		unitsnum = devicesnum;
+	playersPerUnit = keymap_players(&config->keymap);
+	gpadsnum = unitsnum * playersPerUnit;
+	if (gpadsnum > GPADS_MAX) {
+		fprintf(stderr, "%d sticks with %d players each exceed %d gamepads\n",
+				unitsnum, playersPerUnit, GPADS_MAX);
+		exit(EXIT_FAILURE);
+	}
+	if (replay_file != NULL) {
+		if (output == NULL)
+			output = &output_memory;
+		if (realtime)
+			rt_enter(&config->rt);
+		/* the same recording through both pipelines, one after the other */
+		if (compare && replay_run(replay_file, config, unitsnum, loops, 0,
+				output, output_arg) != 0)
+			return EXIT_FAILURE;
+		return replay_run(replay_file, config, unitsnum, loops,
+				threaded || compare, output, output_arg) == 0
+				? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+	if (output == NULL)
+		output = &output_uinput;
+	if (record_file != NULL && trace_create(&recorder, record_file) != 0)
+		exit(EXIT_FAILURE);
+
+	for (ctr = 0; ctr < unitsnum; ctr++) {
+		if (input_xarcade_init(&units[ctr].xarcdev, config->read_buffer) != 0) {
+			fprintf(stderr, "Out of memory\n");
+			exit(EXIT_FAILURE);
+		}
+		translate_unit_init(&units[ctr].state, &translator, ctr * playersPerUnit);
+	}
+
+	/* connect now instead of with the first message from the main loop */
+	if (use_syslog)
+		openlog("xarcade2jstick", LOG_NDELAY | LOG_PID, LOG_DAEMON);
 	SYSLOG(LOG_NOTICE, "Starting.");
 
-	printf("[Xarcade2Joystick] Getting exclusive access: ");
-	int retry_time=3;
-	while ( input_xarcade_open(&xarcdev, INPUT_XARC_TYPE_TANKSTICK) != 0) {
-		if (errno == 0) {
-			printf("Not found.\n");
-			SYSLOG(LOG_ERR, "Xarcade not found, exiting.");
-		} else {
-			printf("Failed to get exclusive access to Xarcade: %d (%s)\n", errno, strerror(errno));
-			SYSLOG(LOG_ERR, "Failed to get exclusive access to Xarcade, exiting: %d (%s)", errno, strerror(errno));
+	/* watch before scanning, so a stick plugged in meanwhile is not missed */
+	if (input_hotplug_open(&hotplug) != 0) {
+		SYSLOG(LOG_ERR, "Unable to watch for input devices, exiting.");
+		return 1;
+	}
+
+	epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (epfd < 0 || epollAdd(hotplug.fd, EPOLL_TAG_HOTPLUG) != 0) {
+		SYSLOG(LOG_ERR, "Unable to set up epoll, exiting.");
+		return 1;
+	}
+	if (threaded) {
+		wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		stopfd = eventfd(0, EFD_CLOEXEC);
+		if (wakefd < 0 || stopfd < 0 || epollAdd(wakefd, EPOLL_TAG_PIPELINE) != 0) {
+			SYSLOG(LOG_ERR, "Unable to set up the reader threads, exiting.");
+			return 1;
 		}
-		printf("Retrying in %ds.\n", retry_time);
-		sleep( retry_time );
-		retry_time *= 2;
-		if (retry_time>30) retry_time=30;
 	}
 
-	SYSLOG(LOG_NOTICE, "Got exclusive access to Xarcade.");
+	printf("[Xarcade2Joystick] Getting exclusive access.\n");
+	if (devicesnum > 0) {
+		for (ctr = 0; ctr < devicesnum; ctr++)
+			attachDevice(NULL, devicePaths[ctr]);
+	} else {
+		input_xarcade_scan(attachDevice, NULL);
+	}
+	if (units[0].xarcdev.fevdev == -1) {
+		printf("Not found, waiting for it to be plugged in.\n");
+		SYSLOG(LOG_NOTICE, "Xarcade not found, waiting for it.");
+	}
+
+	uinp_gpads = calloc(gpadsnum, sizeof(UINP_GPAD_DEV));
+	sticks = calloc(gpadsnum, sizeof(STICK));
+	registered = calloc(playersPerUnit + 1, sizeof(KEYMAP_TARGETS));
+	if (uinp_gpads == NULL || sticks == NULL || registered == NULL) {
+		SYSLOG(LOG_ERR, "Out of memory, exiting.");
+		return 1;
+	}
+	for (ctr = 0; ctr < playersPerUnit; ctr++)
+		keymap_targets(&config->keymap, ctr, &registered[ctr]);
+	keymap_targets(&config->keymap, KEYMAP_PLAYER_KBD, &registered[playersPerUnit]);
 
-	uinput_gpad_open(&uinp_gpads[0], UINPUT_GPAD_TYPE_XARCADE, 1);
-	uinput_gpad_open(&uinp_gpads[1], UINPUT_GPAD_TYPE_XARCADE, 2);
-	uinput_kbd_open(&uinp_kbd);
+	devicesStart = latency_now();
+	for (ctr = 0; ctr < gpadsnum; ctr++) {
+		if (uinput_gpad_open(&uinp_gpads[ctr], output, output_arg,
+				config->directions[ctr % playersPerUnit], ctr + 1,
+				&registered[ctr % playersPerUnit]) != 0) {
+			SYSLOG(LOG_ERR, "Unable to create the virtual gamepads, exiting.");
+			teardown();
+			return 1;
+		}
+	}
+	if (uinput_kbd_open(&uinp_kbd, output, output_arg,
+			&registered[playersPerUnit]) != 0) {
+		SYSLOG(LOG_ERR, "Unable to create the virtual keyboard, exiting.");
+		teardown();
+		return 1;
+	}
+	devicesTime = latency_now() - devicesStart;
+	translator.gpads = uinp_gpads;
+	translator.sticks = sticks;
+	translator.gpadsnum = gpadsnum;
+	useConfig(config);
+	translator.kbd = &uinp_kbd;
+	translator.sched = &sched;
+	if (timer_sched_open(&sched) != 0 || epollAdd(sched.fd, EPOLL_TAG_TIMER) != 0) {
+		SYSLOG(LOG_ERR, "Unable to create the event scheduler, exiting.");
+		teardown();
+		return 1;
+	}
 
 	if (detach) {
 		if (daemon(0, 1)) {
@@ -112,175 +622,252 @@ int main(int argc, char* argv[]) {
 	}
 	signal(SIGINT, signal_handler);
 	signal(SIGTERM, signal_handler);
+	signal(SIGUSR1, stats_handler);
+	signal(SIGHUP, reload_handler);
+	/* the signals only come in while the main loop waits, so none of them
+	 * is left lying until the next event. The threads started below keep
+	 * them blocked for good. */
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGINT);
+	sigaddset(&signals, SIGTERM);
+	sigaddset(&signals, SIGUSR1);
+	sigaddset(&signals, SIGHUP);
+	sigprocmask(SIG_BLOCK, &signals, &waitMask);
+
+	/* requests are answered from the main loop, between two batches */
+	if (control_path != NULL) {
+		if (control_open(&control, control_path, controlCommands,
+				sizeof(controlCommands) / sizeof(controlCommands[0]), NULL) != 0
+				|| epollAdd(control.fd, EPOLL_TAG_CONTROL) != 0)
+			SYSLOG(LOG_WARNING, "No control socket, continuing without.");
+	}
+	if (state_path != NULL && state_page_open(&statePage, state_path, unitsnum,
+			gpadsnum + 1) != 0)
+		SYSLOG(LOG_WARNING, "No state page, continuing without.");
 
-	SYSLOG(LOG_NOTICE, "Running.");
+	/* after daemon(), the memory locks would not survive the fork */
+	if (realtime && rt_enter(&config->rt) != 0)
+		SYSLOG(LOG_WARNING, "Real-time mode only partly active.");
 
-	while (1) {
-		rd = input_xarcade_read(&xarcdev);
-		if (rd < 0) {
-			break;
+	/* threads neither survive daemon() nor get the settings of rt_enter()
+	 * when started before */
+	if (threaded) {
+		readersRunning = 1;
+		for (ctr = 0; ctr < unitsnum; ctr++) {
+			if (units[ctr].xarcdev.fevdev != -1 && startReader(&units[ctr]) != 0)
+				SYSLOG(LOG_ERR, "No reader thread for %s.", units[ctr].xarcdev.path);
 		}
+	}
 
-		for (ctr = 0; ctr < rd; ctr++) {
-			if (xarcdev.ev[ctr].type == 0)
-				continue;
-			if (xarcdev.ev[ctr].type == EV_MSC)
+	/* from here on messages of the main loop are written by a thread of
+	 * its own, after daemon() and without the priority of rt_enter() */
+	if (logger_start(use_syslog) != 0)
+		SYSLOG(LOG_WARNING, "No log thread, logging synchronously.");
+
+	readyTime = latency_now();
+	printf("[Xarcade2Joystick] Ready after %llu us, the virtual devices took %llu us\n",
+			(unsigned long long) (readyTime - startTime) / 1000,
+			(unsigned long long) devicesTime / 1000);
+	SYSLOG(LOG_NOTICE, "Running, ready after %llu us.",
+			(unsigned long long) (readyTime - startTime) / 1000);
+
+	struct epoll_event events[EPOLL_TAG_XARCADE + INPUT_XARC_DEVS_MAX];
+	while (!exitSignal) {
+		if (dumpStats) {
+			dumpStats = 0;
+			printStats();
+		}
+		if (reloadConfig) {
+			char reply[CONTROL_LINE_MAX];
+
+			reloadConfig = 0;
+			if (switchConfig(configPath, reply, sizeof(reply)) != 0) {
+				reply[strcspn(reply, "\n")] = '\0';
+				LOGGER(LOG_ERR, "[Xarcade2Joystick] Reload failed: %s", reply);
+			}
+		}
+		nev = epoll_pwait(epfd, events, sizeof(events) / sizeof(events[0]), -1,
+				&waitMask);
+		if (nev < 0) {
+			if (errno == EINTR)
 				continue;
-			if (EV_KEY == xarcdev.ev[ctr].type) {
-
-				keyStates[xarcdev.ev[ctr].code] = xarcdev.ev[ctr].value;
-
-				int value = xarcdev.ev[ctr].value;
-				int isPressed = value > 0;
-				switch (xarcdev.ev[ctr].code) {
-
-				/* ----------------  Player 1 controls ------------------- */
-				/* buttons */
-				case KEY_LEFTCTRL:
-				  outputKeyPress(0,BTN_A, isPressed);
-					break;
-				case KEY_LEFTALT:
-					outputKeyPress(0,BTN_B, isPressed);
-					break;
-				case KEY_SPACE:
-					outputKeyPress(0,BTN_C, isPressed);
-					break;
-				case KEY_LEFTSHIFT:
-					outputKeyPress(0,BTN_X, isPressed);
-					break;
-				case KEY_Z:
-					outputKeyPress(0,BTN_Y, isPressed);
-					break;
-				case KEY_X:
-					outputKeyPress(0,BTN_Z, isPressed);
-					break;
-				case KEY_C:
-					outputKeyPress(0,BTN_TL, isPressed);
-					break;
-				case KEY_5:
-					outputKeyPress(0,BTN_TR, isPressed);
-					break;
-				case KEY_1:
-					outputKeyPress(0,BTN_START, isPressed);
-					break;
-				case KEY_3:
-					outputKeyPress(0,BTN_SELECT, isPressed);
-					break;
-				case KEY_KP4:
-				case KEY_LEFT:
-					outputAxisChange(0,ABS_X, value == 0 ? 2 : 0); // center or left
-					break;
-				case KEY_KP6:
-				case KEY_RIGHT:
-					outputAxisChange(0,ABS_X,	value == 0 ? 2 : 4); // center or right
-					break;
-				case KEY_KP8:
-				case KEY_UP:
-					outputAxisChange(0,ABS_Y,	value == 0 ? 2 : 0); // center or up
-					break;
-				case KEY_KP2:
-				case KEY_DOWN:
-					outputAxisChange(0,ABS_Y,	value == 0 ? 2 : 4); // center or down
-					break;
-
-					/* ----------------  Player 2 controls ------------------- */
-					/* buttons */
-				case KEY_A:
-					outputKeyPress(1,BTN_A,	isPressed);
-					break;
-				case KEY_S:
-					outputKeyPress(1,BTN_B, isPressed);
-					break;
-				case KEY_Q:
-					outputKeyPress(1,BTN_C, isPressed);
-					break;
-				case KEY_W:
-					outputKeyPress(1,BTN_X, isPressed);
-					break;
-				case KEY_E:
-					outputKeyPress(1,BTN_Y, isPressed);
-					break;
-				case KEY_LEFTBRACE:
-					outputKeyPress(1,BTN_Z, isPressed);
-					break;
-				case KEY_RIGHTBRACE:
-					outputKeyPress(1,BTN_TL, isPressed);
-					break;
-				case KEY_6:
-					outputKeyPress(1,BTN_TR, isPressed);
-					break;
-				case KEY_2:
-					/* handle combination */
-					if (keyStates[KEY_4] && xarcdev.ev[ctr].value) {
-						uinput_kbd_write(&uinp_kbd, KEY_TAB, 1, EV_KEY);
-						uinput_kbd_sleep();
-						uinput_kbd_write(&uinp_kbd, KEY_TAB, 0, EV_KEY);
-						combo = 2;
-						continue;
-					}
-					/* it's a key down, ignore */
-					if (xarcdev.ev[ctr].value)
-						continue;
-					if (!combo) {
-						outputKeyPress(1,BTN_START, 1);
-						uinput_gpad_sleep();
-						outputKeyPress(1,BTN_START, 0);
-					} else
-						combo--;
-					break;
-				case KEY_4:
-					/* it's a key down, ignore */
-					if (xarcdev.ev[ctr].value)
-						continue;
-					if (!combo) {
-						outputKeyPress(1,BTN_SELECT, 1);
-						uinput_gpad_sleep();
-						outputKeyPress(1,BTN_SELECT, 0);
-					} else
-						combo--;
-
-					break;
-
-					/* joystick */
-				case KEY_D:
-					outputAxisChange(1,ABS_X, value == 0 ? 2 : 0); // center or left
-					break;
-				case KEY_G:
-					outputAxisChange(1,ABS_X, value == 0 ? 2 : 4); // center or right
-					break;
-				case KEY_R:
-					outputAxisChange(1,ABS_Y, value == 0 ? 2 : 0); // center or up
-					break;
-				case KEY_F:
-					outputAxisChange(1,ABS_Y,value == 0 ? 2 : 4); // center or down
-					break;
-
-				default:
-					break;
+			break;
+		}
+
+		for (ctr = 0; ctr < nev; ctr++) {
+			if (events[ctr].data.u32 == EPOLL_TAG_TIMER) {
+				/* deferred releases are due */
+				timer_sched_dispatch(&sched);
+				translate_flush(&translator);
+			} else if (events[ctr].data.u32 == EPOLL_TAG_HOTPLUG) {
+				input_hotplug_read(&hotplug, attachDevice, NULL);
+			} else if (events[ctr].data.u32 == EPOLL_TAG_PIPELINE) {
+				drainReaders();
+			} else if (events[ctr].data.u32 == EPOLL_TAG_CONTROL) {
+				rd = control_accept(&control);
+				if (rd >= 0)
+					epollAdd(control.clients[rd].fd, EPOLL_TAG_CLIENT + rd);
+			} else if (events[ctr].data.u32 < EPOLL_TAG_XARCADE) {
+				/* a closed connection leaves the epoll set by itself */
+				control_read(&control, events[ctr].data.u32 - EPOLL_TAG_CLIENT);
+			} else {
+				unit = &units[events[ctr].data.u32 - EPOLL_TAG_XARCADE];
+				if (unit->xarcdev.fevdev == -1)
+					continue;
+				rd = input_xarcade_read(&unit->xarcdev);
+				if (rd < 0 || (events[ctr].events & (EPOLLERR | EPOLLHUP)))
+					detachDevice(unit);
+				else if (rd > 0) {
+					if (recorder.fd != -1)
+						trace_write(&recorder, unit - units, unit->xarcdev.ev, rd);
+					translate_events(&translator, &unit->state, unit->xarcdev.ev, rd);
 				}
 			}
 		}
+		if (statePage.page != NULL)
+			publishState();
 	}
 
+	/* a second signal ends the process at once, even while tearing down */
+	sigprocmask(SIG_SETMASK, &waitMask, NULL);
+	if (exitSignal)
+		LOGGER(LOG_NOTICE, "Received signal %d (%s), exiting.", (int) exitSignal,
+				strsignal(exitSignal));
 	teardown();
 	return EXIT_SUCCESS;
 }
 
+/* only from main, never from a signal handler: the loop has finished its
+ * last batch, so the readers can be stopped and joined safely */
 static void teardown() {
+	int ctr;
+
+	logger_stop();
 	printf("Exiting.\n");
 	SYSLOG(LOG_NOTICE, "Exiting.");
-	
-	input_xarcade_close(&xarcdev);
-	uinput_gpad_close(&uinp_gpads[0]);
-	uinput_gpad_close(&uinp_gpads[1]);
+
+	/* the readers use the sticks until they are gone */
+	if (readersRunning) {
+		uint64_t one = 1;
+
+		if (write(stopfd, &one, sizeof(one)) < 0)
+			perror("stop readers");
+		for (ctr = 0; ctr < unitsnum; ctr++)
+			pipeline_reader_join(&units[ctr].reader);
+	}
+
+	for (ctr = 0; ctr < unitsnum; ctr++) {
+		if (units[ctr].xarcdev.fevdev != -1)
+			input_xarcade_close(&units[ctr].xarcdev);
+	}
+	input_hotplug_close(&hotplug);
+	for (ctr = 0; ctr < gpadsnum; ctr++)
+		uinput_gpad_close(&uinp_gpads[ctr]);
 	uinput_kbd_close(&uinp_kbd);
+	timer_sched_close(&sched);
+	control_close(&control);
+	state_page_close(&statePage);
+	if (recorder.fd != -1)
+		trace_close(&recorder);
 }
 
+/* only flags the request, the main loop leaves and tears down. A second
+ * signal ends the process at once. */
 static void signal_handler(int signum) {
 	signal(signum, SIG_DFL);
+	exitSignal = signum;
+}
 
-	printf("Received signal %d (%s), exiting.\n", signum, strsignal(signum));
-	SYSLOG(LOG_NOTICE, "Received signal %d (%s), exiting.", signum, strsignal(signum));
-	teardown();
-	exit(EXIT_SUCCESS);
+/* copies what was processed in this round of the main loop to the state
+ * page. The latency figures take a while and are refreshed less often. */
+static void publishState() {
+	STATE_PAGE *page = state_page_begin(&statePage);
+	STATE_PAGE_UNIT *punit = STATE_PAGE_UNITS(page);
+	STATE_PAGE_DEV *pdev = STATE_PAGE_DEVS(page);
+	uint64_t now = latency_now();
+	int stats = now >= statePage.statsDue;
+	UINP_BATCH *batch;
+	int ctr, code;
+
+	for (ctr = 0; ctr < unitsnum; ctr++) {
+		punit[ctr].attached = units[ctr].xarcdev.fevdev != -1;
+		memset(punit[ctr].keys, 0, sizeof(punit[ctr].keys));
+		for (code = 0; code < KEYMAP_LEN; code++) {
+			if (units[ctr].state.keyStates[code])
+				punit[ctr].keys[code / 8] |= 1 << (code % 8);
+		}
+		memcpy(punit[ctr].presses, units[ctr].state.presses,
+				sizeof(punit[ctr].presses));
+	}
+	for (ctr = 0; ctr <= gpadsnum; ctr++) {
+		batch = ctr < gpadsnum ? &uinp_gpads[ctr].batch : &uinp_kbd.batch;
+		if (ctr < gpadsnum) {
+			for (code = 0; code < ABS_CNT; code++)
+				pdev[ctr].axes[code] = sticks[ctr].axis[code].dir;
+		}
+		if (stats)
+			latency_stats(&batch->latency, &pdev[ctr].latency);
+		pdev[ctr].sent = batch->sent;
+	}
+	if (stats)
+		statePage.statsDue = now + STATE_PAGE_STATS_NS;
+	state_page_end(&statePage, now);
+}
+
+/* only flags the request, the main loop prints once epoll_pwait returns */
+static void stats_handler(int signum) {
+	dumpStats = 1;
+}
+
+/* like SIGUSR1, the main loop does the work */
+static void reload_handler(int signum) {
+	reloadConfig = 1;
+}
+
+/* stats */
+static int16_t controlStats(void *ctx, int argc, char *argv[], char *reply,
+		size_t len) {
+	size_t pos = 0;
+	int ctr;
+
+	for (ctr = 0; pos + 1 < len && statsLine(ctr, reply + pos, len - pos - 1) == 0; ctr++) {
+		pos += strlen(reply + pos);
+		reply[pos++] = '\n';
+		reply[pos] = '\0';
+	}
+	return 0;
+}
+
+/* profile [name|path], a bare name is looked up in CONFIG_PROFILE_DIR and a
+ * path has to be absolute */
+static int16_t controlProfile(void *ctx, int argc, char *argv[], char *reply,
+		size_t len) {
+	char path[PATH_MAX];
+
+	if (argc == 1) {
+		snprintf(reply, len, "%s\n", configPath[0] != '\0' ? configPath : "built-in layout");
+		return 0;
+	}
+	if (argc != 2) {
+		snprintf(reply, len, "usage: profile [name|path]\n");
+		return -1;
+	}
+	if (strcmp(argv[1], "default") == 0)
+		path[0] = '\0';
+	else if (argv[1][0] == '/')
+		snprintf(path, sizeof(path), "%s", argv[1]);
+	else if (strchr(argv[1], '/') != NULL) {
+		/* neither the daemon nor a client share a directory to resolve it in */
+		snprintf(reply, len, "%s is not an absolute path\n", argv[1]);
+		return -1;
+	}
+	else
+		snprintf(path, sizeof(path), "%s/%s.conf", CONFIG_PROFILE_DIR, argv[1]);
+	return switchConfig(path, reply, len);
+}
+
+/* reload, reads the current profile again */
+static int16_t controlReload(void *ctx, int argc, char *argv[], char *reply,
+		size_t len) {
+	return switchConfig(configPath, reply, len);
 }
@@ -0,0 +1,90 @@
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 2014, Florian Mueller                      */
+/* ======================================================================== */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "output.h"
+
+static const OUTPUT_BACKEND *output_backends[] = {
+	&output_uinput,
+	&output_memory,
+	&output_file,
+};
+
+// relizations ----------------------
+/* resolves "name" or "name:argument", arg points behind the colon or is NULL */
+const OUTPUT_BACKEND *output_find(const char *spec, const char **arg) {
+	const char *colon = strchr(spec, ':');
+	size_t len = colon ? (size_t) (colon - spec) : strlen(spec);
+	unsigned int ctr;
+
+	*arg = colon ? colon + 1 : NULL;
+	for (ctr = 0; ctr < sizeof(output_backends) / sizeof(output_backends[0]); ctr++) {
+		if (strlen(output_backends[ctr]->name) == len
+				&& strncmp(output_backends[ctr]->name, spec, len) == 0)
+			return output_backends[ctr];
+	}
+	return NULL;
+}
+
+int16_t output_create(OUTPUT_DEV* const dev, const OUTPUT_BACKEND *backend,
+		const char *arg, const OUTPUT_SPEC* const spec) {
+	dev->backend = backend;
+	dev->fd = -1;
+	dev->priv = NULL;
+	if (backend->create(dev, spec, arg) != 0) {
+		/* nothing to destroy later on */
+		dev->backend = NULL;
+		return -1;
+	}
+	return 0;
+}
+
+int16_t output_emit(OUTPUT_DEV* const dev, const struct input_event *ev,
+		uint16_t count) {
+	return dev->backend->emit(dev, ev, count);
+}
+
+int16_t output_destroy(OUTPUT_DEV* const dev) {
+	if (dev->backend == NULL)
+		return 0;
+	return dev->backend->destroy(dev);
+}
+
+void output_spec_init(OUTPUT_SPEC* const spec, const char *name) {
+	memset(spec, 0, sizeof(*spec));
+	snprintf(spec->name, sizeof(spec->name), "%s", name);
+	spec->id.version = 4;
+	spec->id.bustype = BUS_USB;
+	spec->id.product = 1;
+	spec->id.vendor = 1;
+}
+
+void output_spec_key(OUTPUT_SPEC* const spec, uint16_t code) {
+	OUTPUT_BIT_SET(spec->evbits, EV_KEY);
+	OUTPUT_BIT_SET(spec->keybits, code);
+}
+
+void output_spec_abs(OUTPUT_SPEC* const spec, uint16_t code, int32_t min,
+		int32_t max) {
+	OUTPUT_BIT_SET(spec->evbits, EV_ABS);
+	OUTPUT_BIT_SET(spec->absbits, code);
+	spec->absinfo[code].minimum = min;
+	spec->absinfo[code].maximum = max;
+}
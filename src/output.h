@@ -0,0 +1,74 @@
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 2014, Florian Mueller                      */
+/* ======================================================================== */
+
+#ifndef OUTPUT_H_
+#define OUTPUT_H_
+
+#include <stdint.h>
+#include <linux/input.h>
+
+#define OUTPUT_BIT_SET(bits, bit) ((bits)[(bit) / 8] |= 1 << ((bit) % 8))
+#define OUTPUT_BIT_TEST(bits, bit) ((bits)[(bit) / 8] & (1 << ((bit) % 8)))
+
+/* name, ids and capabilities of a virtual device */
+typedef struct {
+	char name[80];
+	struct input_id id;
+	uint8_t evbits[(EV_CNT + 7) / 8];
+	uint8_t keybits[(KEY_CNT + 7) / 8];
+	uint8_t absbits[(ABS_CNT + 7) / 8];
+	struct input_absinfo absinfo[ABS_CNT];
+} OUTPUT_SPEC;
+
+typedef struct OUTPUT_DEV OUTPUT_DEV;
+
+/* where the events of the virtual devices end up */
+typedef struct {
+	const char *name;
+	int16_t (*create)(OUTPUT_DEV* const dev, const OUTPUT_SPEC* const spec,
+			const char *arg);
+	/* ev holds count events, the last one being the SYN_REPORT */
+	int16_t (*emit)(OUTPUT_DEV* const dev, const struct input_event *ev,
+			uint16_t count);
+	int16_t (*destroy)(OUTPUT_DEV* const dev);
+} OUTPUT_BACKEND;
+
+struct OUTPUT_DEV {
+	const OUTPUT_BACKEND *backend;
+	int fd;
+	void *priv;
+};
+
+extern const OUTPUT_BACKEND output_uinput;
+extern const OUTPUT_BACKEND output_memory;
+extern const OUTPUT_BACKEND output_file;
+
+const OUTPUT_BACKEND *output_find(const char *spec, const char **arg);
+int16_t output_create(OUTPUT_DEV* const dev, const OUTPUT_BACKEND *backend,
+		const char *arg, const OUTPUT_SPEC* const spec);
+int16_t output_emit(OUTPUT_DEV* const dev, const struct input_event *ev,
+		uint16_t count);
+int16_t output_destroy(OUTPUT_DEV* const dev);
+void output_spec_init(OUTPUT_SPEC* const spec, const char *name);
+void output_spec_key(OUTPUT_SPEC* const spec, uint16_t code);
+void output_spec_abs(OUTPUT_SPEC* const spec, uint16_t code, int32_t min,
+		int32_t max);
+uint16_t output_memory_read(OUTPUT_DEV* const dev, struct input_event *ev,
+		uint16_t max);
+
+#endif /* OUTPUT_H_ */
@@ -0,0 +1,77 @@
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 2014, Florian Mueller                      */
+/* ======================================================================== */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "output.h"
+#include "trace.h"
+
+// declaration of supplementary functions  -------------------
+static int16_t output_file_create(OUTPUT_DEV* const dev,
+		const OUTPUT_SPEC* const spec, const char *arg);
+static int16_t output_file_emit(OUTPUT_DEV* const dev,
+		const struct input_event *ev, uint16_t count);
+static int16_t output_file_destroy(OUTPUT_DEV* const dev);
+
+const OUTPUT_BACKEND output_file = {
+	"file",
+	output_file_create,
+	output_file_emit,
+	output_file_destroy
+};
+
+/* all devices share one trace, the unit of a batch is the device number
+ * in order of creation, so the result can be fed to --replay or diffed */
+static TRACE output_file_trace = { .fd = -1 };
+static uint16_t output_file_users;
+static uint16_t output_file_devices;
+
+// supplementary functions -------------------
+
+/* arg is the path of the file or pipe */
+static int16_t output_file_create(OUTPUT_DEV* const dev,
+		const OUTPUT_SPEC* const spec, const char *arg) {
+	if (arg == NULL || *arg == '\0') {
+		printf("[output_file] No path given, use file:PATH\n");
+		return -1;
+	}
+	if (output_file_users == 0) {
+		if (trace_create(&output_file_trace, arg) != 0)
+			return -1;
+		output_file_devices = 0;
+	}
+	output_file_users++;
+	dev->fd = output_file_trace.fd;
+	dev->priv = (void *) (uintptr_t) output_file_devices++;
+	return 0;
+}
+
+static int16_t output_file_emit(OUTPUT_DEV* const dev,
+		const struct input_event *ev, uint16_t count) {
+	return trace_write(&output_file_trace, (uint16_t) (uintptr_t) dev->priv,
+			ev, count);
+}
+
+static int16_t output_file_destroy(OUTPUT_DEV* const dev) {
+	dev->fd = -1;
+	if (--output_file_users > 0)
+		return 0;
+	return trace_close(&output_file_trace);
+}
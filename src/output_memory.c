@@ -0,0 +1,105 @@
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 2014, Florian Mueller                      */
+/* ======================================================================== */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "output.h"
+
+/* default number of events a memory device keeps */
+#define OUTPUT_MEMORY_LEN 4096
+
+typedef struct {
+	/* read and write positions, they only grow */
+	uint64_t head;
+	uint64_t tail;
+	/* events overwritten before they were read */
+	uint64_t overruns;
+	uint32_t len;
+	struct input_event ev[];
+} OUTPUT_MEMORY;
+
+// declaration of supplementary functions  -------------------
+static int16_t output_memory_create(OUTPUT_DEV* const dev,
+		const OUTPUT_SPEC* const spec, const char *arg);
+static int16_t output_memory_emit(OUTPUT_DEV* const dev,
+		const struct input_event *ev, uint16_t count);
+static int16_t output_memory_destroy(OUTPUT_DEV* const dev);
+
+const OUTPUT_BACKEND output_memory = {
+	"memory",
+	output_memory_create,
+	output_memory_emit,
+	output_memory_destroy
+};
+
+// relizations ----------------------
+/* takes up to max of the oldest events out of a memory device */
+uint16_t output_memory_read(OUTPUT_DEV* const dev, struct input_event *ev,
+		uint16_t max) {
+	OUTPUT_MEMORY *mem = dev->priv;
+	uint16_t ctr;
+
+	for (ctr = 0; ctr < max && mem->tail != mem->head; ctr++)
+		ev[ctr] = mem->ev[mem->tail++ % mem->len];
+	return ctr;
+}
+
+// supplementary functions -------------------
+
+/* arg optionally gives the ring size in events */
+static int16_t output_memory_create(OUTPUT_DEV* const dev,
+		const OUTPUT_SPEC* const spec, const char *arg) {
+	OUTPUT_MEMORY *mem;
+	long len = arg ? strtol(arg, NULL, 10) : OUTPUT_MEMORY_LEN;
+
+	if (len <= 0) {
+		printf("[output_memory] Invalid ring size %s\n", arg);
+		return -1;
+	}
+	mem = calloc(1, sizeof(OUTPUT_MEMORY) + len * sizeof(struct input_event));
+	if (mem == NULL) {
+		printf("[output_memory] Unable to allocate %ld events\n", len);
+		return -1;
+	}
+	mem->len = len;
+	dev->priv = mem;
+	return 0;
+}
+
+/* never blocks, a full ring drops its oldest events */
+static int16_t output_memory_emit(OUTPUT_DEV* const dev,
+		const struct input_event *ev, uint16_t count) {
+	OUTPUT_MEMORY *mem = dev->priv;
+	uint16_t ctr;
+
+	for (ctr = 0; ctr < count; ctr++)
+		mem->ev[mem->head++ % mem->len] = ev[ctr];
+	if (mem->head - mem->tail > mem->len) {
+		mem->overruns += mem->head - mem->tail - mem->len;
+		mem->tail = mem->head - mem->len;
+	}
+	return 0;
+}
+
+static int16_t output_memory_destroy(OUTPUT_DEV* const dev) {
+	free(dev->priv);
+	dev->priv = NULL;
+	return 0;
+}
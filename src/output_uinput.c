@@ -0,0 +1,159 @@
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 2014, Florian Mueller                      */
+/* ======================================================================== */
+
+#include <linux/input.h>
+#include <linux/uinput.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+#include "logger.h"
+#include "output.h"
+
+// declaration of supplementary functions  -------------------
+static int16_t output_uinput_create(OUTPUT_DEV* const dev,
+		const OUTPUT_SPEC* const spec, const char *arg);
+static int16_t output_uinput_emit(OUTPUT_DEV* const dev,
+		const struct input_event *ev, uint16_t count);
+static int16_t output_uinput_destroy(OUTPUT_DEV* const dev);
+static int16_t output_uinput_setup(OUTPUT_DEV* const dev,
+		const OUTPUT_SPEC* const spec);
+static int16_t output_uinput_setup_legacy(OUTPUT_DEV* const dev,
+		const OUTPUT_SPEC* const spec);
+
+const OUTPUT_BACKEND output_uinput = {
+	"uinput",
+	output_uinput_create,
+	output_uinput_emit,
+	output_uinput_destroy
+};
+
+// supplementary functions -------------------
+
+/* Setup the uinput device, only the capabilities in spec are registered */
+static int16_t output_uinput_create(OUTPUT_DEV* const dev,
+		const OUTPUT_SPEC* const spec, const char *arg) {
+	int bit;
+
+	dev->fd = open(arg ? arg : "/dev/uinput", O_WRONLY | O_NDELAY | O_CLOEXEC);
+	if (dev->fd < 0) {
+		printf("Unable to open /dev/uinput (running as root may help)\n");
+		return -1;
+	}
+
+	for (bit = 0; bit < EV_CNT; bit++) {
+		if (OUTPUT_BIT_TEST(spec->evbits, bit))
+			ioctl(dev->fd, UI_SET_EVBIT, bit);
+	}
+	for (bit = 0; bit < KEY_CNT; bit++) {
+		if (OUTPUT_BIT_TEST(spec->keybits, bit))
+			ioctl(dev->fd, UI_SET_KEYBIT, bit);
+	}
+	for (bit = 0; bit < ABS_CNT; bit++) {
+		if (OUTPUT_BIT_TEST(spec->absbits, bit))
+			ioctl(dev->fd, UI_SET_ABSBIT, bit);
+	}
+
+	/* Create input device into input sub-system */
+	if (output_uinput_setup(dev, spec) != 0 || ioctl(dev->fd, UI_DEV_CREATE)) {
+		printf("[output_uinput] Unable to create UINPUT device.\n");
+		close(dev->fd);
+		dev->fd = -1;
+		return -1;
+	}
+	return 0;
+}
+
+/* uinput takes any number of events with one write */
+static int16_t output_uinput_emit(OUTPUT_DEV* const dev,
+		const struct input_event *ev, uint16_t count) {
+	if (write(dev->fd, ev, sizeof(struct input_event) * count) < 0) {
+		LOGGER(LOG_ERR, "[output_uinput] Unable to write events: %s",
+				strerror(errno));
+		return -1;
+	}
+	return 0;
+}
+
+static int16_t output_uinput_destroy(OUTPUT_DEV* const dev) {
+	int result;
+
+	if (dev->fd < 0)
+		return 0;
+	ioctl(dev->fd, UI_DEV_DESTROY);
+	result = close(dev->fd);
+	dev->fd = -1;
+	return result;
+}
+
+/* name, ids and axis ranges through UI_DEV_SETUP and UI_ABS_SETUP (Linux
+ * 4.5), kernels without them get the uinput_user_dev write */
+static int16_t output_uinput_setup(OUTPUT_DEV* const dev,
+		const OUTPUT_SPEC* const spec) {
+#ifdef UI_DEV_SETUP
+	struct uinput_setup setup;
+	struct uinput_abs_setup abs;
+	int bit;
+
+	memset(&setup, 0, sizeof(setup));
+	snprintf(setup.name, sizeof(setup.name), "%s", spec->name);
+	setup.id = spec->id;
+	if (ioctl(dev->fd, UI_DEV_SETUP, &setup) != 0) {
+		if (errno == EINVAL || errno == ENOTTY)
+			return output_uinput_setup_legacy(dev, spec);
+		return -1;
+	}
+	for (bit = 0; bit < ABS_CNT; bit++) {
+		if (!OUTPUT_BIT_TEST(spec->absbits, bit))
+			continue;
+		memset(&abs, 0, sizeof(abs));
+		abs.code = bit;
+		abs.absinfo = spec->absinfo[bit];
+		if (ioctl(dev->fd, UI_ABS_SETUP, &abs) != 0)
+			return -1;
+	}
+	return 0;
+#else
+	return output_uinput_setup_legacy(dev, spec);
+#endif
+}
+
+static int16_t output_uinput_setup_legacy(OUTPUT_DEV* const dev,
+		const OUTPUT_SPEC* const spec) {
+	struct uinput_user_dev uinp;
+	int bit;
+
+	memset(&uinp, 0, sizeof(uinp));
+	snprintf(uinp.name, sizeof(uinp.name), "%s", spec->name);
+	uinp.id = spec->id;
+	for (bit = 0; bit < ABS_CNT; bit++) {
+		if (!OUTPUT_BIT_TEST(spec->absbits, bit))
+			continue;
+		uinp.absmin[bit] = spec->absinfo[bit].minimum;
+		uinp.absmax[bit] = spec->absinfo[bit].maximum;
+	}
+	if (write(dev->fd, &uinp, sizeof(uinp)) != sizeof(uinp)) {
+		printf("[output_uinput] Unable to set up the device: %s\n",
+				strerror(errno));
+		return -1;
+	}
+	return 0;
+}
@@ -0,0 +1,199 @@
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 2014, Florian Mueller                      */
+/* ======================================================================== */
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "pipeline.h"
+#include "latency.h"
+#include "logger.h"
+
+// declaration of supplementary functions  -------------------
+static void *pipeline_reader_run(void *arg);
+
+// relizations ----------------------
+void pipeline_ring_init(PIPELINE_RING* const ring) {
+	atomic_init(&ring->head, 0);
+	atomic_init(&ring->tail, 0);
+	atomic_init(&ring->stalls, 0);
+}
+
+/* producer: the slot to fill next, NULL while the ring is full */
+PIPELINE_SLOT *pipeline_ring_claim(PIPELINE_RING* const ring) {
+	uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+	if (head - atomic_load_explicit(&ring->tail, memory_order_acquire)
+			== PIPELINE_SLOTS)
+		return NULL;
+	return &ring->slots[head % PIPELINE_SLOTS];
+}
+
+/* producer: hands the claimed slot over to the consumer */
+void pipeline_ring_publish(PIPELINE_RING* const ring) {
+	atomic_store_explicit(&ring->head,
+			atomic_load_explicit(&ring->head, memory_order_relaxed) + 1,
+			memory_order_release);
+}
+
+/* consumer: the oldest filled slot, NULL if there is none */
+const PIPELINE_SLOT *pipeline_ring_peek(PIPELINE_RING* const ring) {
+	uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+	if (tail == atomic_load_explicit(&ring->head, memory_order_acquire))
+		return NULL;
+	return &ring->slots[tail % PIPELINE_SLOTS];
+}
+
+/* consumer: gives the peeked slot back to the producer */
+void pipeline_ring_release(PIPELINE_RING* const ring) {
+	atomic_store_explicit(&ring->tail,
+			atomic_load_explicit(&ring->tail, memory_order_relaxed) + 1,
+			memory_order_release);
+}
+
+/* producer: queues count events in as many slots as needed and wakes the
+ * consumer once. While the ring is full it waits, -1 if stopfd became
+ * readable meanwhile. */
+int16_t pipeline_push(PIPELINE_RING* const ring, PIPELINE_KIND_E kind,
+		uint16_t unit, const struct input_event *ev, uint16_t count,
+		uint64_t read, int wakefd, int stopfd) {
+	struct pollfd stop = { .fd = stopfd, .events = POLLIN };
+	const struct timespec stall = { 0, PIPELINE_STALL_US * 1000 };
+	PIPELINE_SLOT *slot;
+	uint64_t one = 1;
+	uint16_t chunk;
+
+	do {
+		while ((slot = pipeline_ring_claim(ring)) == NULL) {
+			atomic_fetch_add_explicit(&ring->stalls, 1, memory_order_relaxed);
+			if (write(wakefd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+				return -1;
+			if (stopfd >= 0 && poll(&stop, 1, 0) > 0)
+				return -1;
+			nanosleep(&stall, NULL);
+		}
+		chunk = count > PIPELINE_SLOT_EVS ? PIPELINE_SLOT_EVS : count;
+		slot->kind = kind;
+		slot->unit = unit;
+		slot->count = chunk;
+		slot->more = count > chunk;
+		slot->read = read;
+		if (chunk > 0)
+			memcpy(slot->ev, ev, chunk * sizeof(*ev));
+		pipeline_ring_publish(ring);
+		ev += chunk;
+		count -= chunk;
+	} while (count > 0);
+
+	if (write(wakefd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+		return -1;
+	return 0;
+}
+
+/* consumer: blocks until a producer has pushed something */
+int16_t pipeline_wait(int wakefd) {
+	struct pollfd wake = { .fd = wakefd, .events = POLLIN };
+	uint64_t count;
+
+	while (poll(&wake, 1, -1) < 0) {
+		if (errno != EINTR)
+			return -1;
+	}
+	return read(wakefd, &count, sizeof(count)) < 0 && errno != EAGAIN ? -1 : 0;
+}
+
+/* starts a thread that reads xdev into the ring of reader. Signals stay
+ * with the thread that created it. The thread records its reads before
+ * they are split into slots, so recordings look like without --threads. */
+int16_t pipeline_reader_start(PIPELINE_READER* const reader,
+		INP_XARC_DEV* const xdev, uint16_t unit, int wakefd, int stopfd,
+		TRACE* const recorder) {
+	pthread_attr_t attr;
+	sigset_t all, old;
+	int result;
+
+	reader->xdev = xdev;
+	reader->unit = unit;
+	reader->wakefd = wakefd;
+	reader->stopfd = stopfd;
+	reader->recorder = recorder;
+	pipeline_ring_init(&reader->ring);
+
+	pthread_attr_init(&attr);
+	pthread_attr_setstacksize(&attr, PIPELINE_STACK_SIZE);
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &old);
+	result = pthread_create(&reader->thread, &attr, pipeline_reader_run, reader);
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+	pthread_attr_destroy(&attr);
+	if (result != 0) {
+		LOGGER(LOG_ERR, "[pipeline] Unable to start a reader thread: %s",
+				strerror(result));
+		return -1;
+	}
+	reader->running = 1;
+	return 0;
+}
+
+/* waits for a reader that has ended or was stopped through stopfd */
+int16_t pipeline_reader_join(PIPELINE_READER* const reader) {
+	if (!reader->running)
+		return 0;
+	reader->running = 0;
+	return pthread_join(reader->thread, NULL) == 0 ? 0 : -1;
+}
+
+// supplementary functions -------------------
+
+static void *pipeline_reader_run(void *arg) {
+	PIPELINE_READER *reader = arg;
+	struct pollfd fds[2] = {
+		{ .fd = reader->xdev->fevdev, .events = POLLIN },
+		{ .fd = reader->stopfd, .events = POLLIN },
+	};
+	int16_t rd;
+
+	while (1) {
+		if (poll(fds, 2, -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		if (fds[1].revents)
+			return NULL;
+		rd = input_xarcade_read(reader->xdev);
+		if (rd < 0 || (fds[0].revents & (POLLERR | POLLHUP)))
+			break;
+		/* one writev() per batch, readers of several sticks do not mix */
+		if (rd > 0 && reader->recorder != NULL)
+			trace_write(reader->recorder, reader->unit, reader->xdev->ev, rd);
+		if (rd > 0 && pipeline_push(&reader->ring, PIPELINE_KIND_EVENTS,
+				reader->unit, reader->xdev->ev, rd, latency_now(),
+				reader->wakefd, reader->stopfd) != 0)
+			return NULL;
+	}
+	/* the consumer closes the stick and joins */
+	pipeline_push(&reader->ring, PIPELINE_KIND_CLOSED, reader->unit, NULL, 0,
+			latency_now(), reader->wakefd, reader->stopfd);
+	return NULL;
+}
@@ -0,0 +1,95 @@
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 2014, Florian Mueller                      */
+/* ======================================================================== */
+
+#ifndef PIPELINE_H_
+#define PIPELINE_H_
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <linux/input.h>
+
+#include "input_xarcade.h"
+#include "trace.h"
+
+/* slots of a ring, a power of two */
+#define PIPELINE_SLOTS 32
+/* events of one slot, longer reads take several slots */
+#define PIPELINE_SLOT_EVS 64
+/* how long a producer sleeps while the ring is full, in us */
+#define PIPELINE_STALL_US 100
+/* stack of a reader thread, mlockall() of -r pins all of it */
+#define PIPELINE_STACK_SIZE (64 * 1024)
+
+typedef enum {
+	PIPELINE_KIND_EVENTS = 0,	// events read from a stick
+	PIPELINE_KIND_CLOSED = 1,	// the stick went away, the reader has ended
+	PIPELINE_KIND_MARK = 2		// no events, a point the consumer waits for
+} PIPELINE_KIND_E;
+
+typedef struct {
+	uint8_t kind;
+	uint16_t unit;
+	uint16_t count;
+	/* the next slot carries more events of the same read */
+	uint8_t more;
+	/* monotonic time in ns the producer got the events */
+	uint64_t read;
+	struct input_event ev[PIPELINE_SLOT_EVS];
+} PIPELINE_SLOT;
+
+/* single producer, single consumer, lock-free. head and tail only grow,
+ * each one is written by one side and read by the other. */
+typedef struct {
+	_Alignas(64) atomic_uint_least32_t head;
+	_Alignas(64) atomic_uint_least32_t tail;
+	/* times the producer found the ring full */
+	atomic_uint_least64_t stalls;
+	PIPELINE_SLOT slots[PIPELINE_SLOTS];
+} PIPELINE_RING;
+
+/* a thread reading one stick into its own ring */
+typedef struct {
+	pthread_t thread;
+	INP_XARC_DEV *xdev;
+	uint16_t unit;
+	/* eventfd the consumer waits on, may be shared by several readers */
+	int wakefd;
+	/* eventfd that ends the reader once readable */
+	int stopfd;
+	/* --record, gets every read whole, NULL if not recording */
+	TRACE *recorder;
+	uint8_t running;
+	PIPELINE_RING ring;
+} PIPELINE_READER;
+
+void pipeline_ring_init(PIPELINE_RING* const ring);
+PIPELINE_SLOT *pipeline_ring_claim(PIPELINE_RING* const ring);
+void pipeline_ring_publish(PIPELINE_RING* const ring);
+const PIPELINE_SLOT *pipeline_ring_peek(PIPELINE_RING* const ring);
+void pipeline_ring_release(PIPELINE_RING* const ring);
+int16_t pipeline_push(PIPELINE_RING* const ring, PIPELINE_KIND_E kind,
+		uint16_t unit, const struct input_event *ev, uint16_t count,
+		uint64_t read, int wakefd, int stopfd);
+int16_t pipeline_wait(int wakefd);
+int16_t pipeline_reader_start(PIPELINE_READER* const reader,
+		INP_XARC_DEV* const xdev, uint16_t unit, int wakefd, int stopfd,
+		TRACE* const recorder);
+int16_t pipeline_reader_join(PIPELINE_READER* const reader);
+
+#endif /* PIPELINE_H_ */
@@ -0,0 +1,317 @@
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 2014, Florian Mueller                      */
+/* ======================================================================== */
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#include "replay.h"
+#include "pipeline.h"
+#include "trace.h"
+#include "translate.h"
+#include "latency.h"
+
+/* a replay in progress, shared with the producer thread of --threads */
+typedef struct {
+	TRACE trace;
+	uint8_t units;
+	uint32_t loops;
+	TIMER_SCHED sched;
+	TRANSLATE_CTX ctx;
+	TRANSLATE_UNIT *state;
+	/* time of the last event of the current loop */
+	uint64_t last;
+	/* the batch being translated continues the previous one */
+	uint8_t continued;
+	/* counted by whoever reads the trace */
+	uint64_t batches;
+	uint64_t events;
+	/* from reading a batch to its translation being written */
+	LATENCY_HIST handoff;
+	/* --threads only */
+	PIPELINE_RING ring;
+	int wakefd;
+} REPLAY;
+
+// declaration of supplementary functions  -------------------
+static void replay_close(UINP_GPAD_DEV *gpads, int gpadsnum,
+		UINP_KBD_DEV* const kbd);
+static void replay_batch(REPLAY* const replay, uint16_t unit,
+		const struct input_event *ev, uint16_t count, uint64_t read,
+		uint8_t more);
+static void replay_loop_end(REPLAY* const replay);
+static int16_t replay_direct(REPLAY* const replay);
+static int16_t replay_threads(REPLAY* const replay);
+static void *replay_produce(void *arg);
+
+// relizations ----------------------
+/* feeds a recording through the translation into devices on the given
+ * backend and reports the throughput, no stick or uinput needed. With
+ * threaded, the recording is read by a thread of its own and handed over
+ * like the sticks are with --threads. */
+int16_t replay_run(const char *path, const CONFIG* const config,
+		uint8_t units, uint32_t loops, uint8_t threaded,
+		const OUTPUT_BACKEND *output, const char *output_arg) {
+	REPLAY *replay;
+	UINP_GPAD_DEV *gpads;
+	STICK *sticks;
+	UINP_KBD_DEV kbd;
+	KEYMAP_TARGETS targets;
+	char line[200];
+	uint64_t sent = 0, debounced = 0;
+	uint64_t begin, elapsed;
+	int playersPerUnit;
+	int16_t result;
+	int ctr;
+
+	replay = calloc(1, sizeof(REPLAY));
+	if (replay == NULL || trace_open(&replay->trace, path) != 0) {
+		free(replay);
+		return -1;
+	}
+	replay->units = units;
+	replay->loops = loops;
+
+	playersPerUnit = keymap_players(&config->keymap);
+	gpads = calloc(units * playersPerUnit, sizeof(UINP_GPAD_DEV));
+	sticks = calloc(units * playersPerUnit, sizeof(STICK));
+	replay->state = calloc(units, sizeof(TRANSLATE_UNIT));
+	memset(&kbd, 0, sizeof(kbd));
+	if (gpads == NULL || sticks == NULL || replay->state == NULL) {
+		printf("[replay] Out of memory\n");
+		free(gpads);
+		free(sticks);
+		free(replay->state);
+		trace_close(&replay->trace);
+		free(replay);
+		return -1;
+	}
+	for (ctr = 0; ctr < units * playersPerUnit; ctr++) {
+		keymap_targets(&config->keymap, ctr % playersPerUnit, &targets);
+		if (uinput_gpad_open(&gpads[ctr], output, output_arg,
+				config->directions[ctr % playersPerUnit], ctr + 1, &targets) != 0)
+			break;
+	}
+	keymap_targets(&config->keymap, KEYMAP_PLAYER_KBD, &targets);
+	if (ctr < units * playersPerUnit
+			|| uinput_kbd_open(&kbd, output, output_arg, &targets) != 0) {
+		printf("[replay] Unable to set up the %s output\n", output->name);
+		replay_close(gpads, units * playersPerUnit, &kbd);
+		free(sticks);
+		free(replay->state);
+		trace_close(&replay->trace);
+		free(replay);
+		return -1;
+	}
+	for (ctr = 0; ctr < units; ctr++)
+		translate_unit_init(&replay->state[ctr], &replay->ctx, ctr * playersPerUnit);
+
+	timer_sched_open_virtual(&replay->sched, 0);
+	replay->ctx.keymap = &config->keymap;
+	replay->ctx.gpads = gpads;
+	replay->ctx.sticks = sticks;
+	replay->ctx.gpadsnum = units * playersPerUnit;
+	replay->ctx.socd = config->socd;
+	replay->ctx.chord_window = config->chord_window;
+	replay->ctx.debounce = &config->debounce;
+	replay->ctx.turbo = &config->turbo;
+	for (ctr = 0; ctr < units * playersPerUnit; ctr++)
+		gpads[ctr].batch.stamp = config->timestamps;
+	kbd.batch.stamp = config->timestamps;
+	replay->ctx.kbd = &kbd;
+	replay->ctx.sched = &replay->sched;
+	replay->ctx.source = 0;
+
+	begin = latency_now();
+	result = threaded ? replay_threads(replay) : replay_direct(replay);
+	elapsed = latency_now() - begin;
+
+	for (ctr = 0; ctr < units * playersPerUnit; ctr++)
+		sent += gpads[ctr].batch.sent;
+	sent += kbd.batch.sent;
+	for (ctr = 0; ctr < units; ctr++)
+		debounced += replay->state[ctr].debounce.suppressed;
+	printf("[replay] %llu batches, %llu events in, %llu events out, %u loop(s)\n",
+			(unsigned long long) replay->batches,
+			(unsigned long long) replay->events,
+			(unsigned long long) sent, loops);
+	if (replay->events) {
+		printf("[replay] %.3f ms, %.0f events/s, %.1f ns/event\n",
+				elapsed / 1e6, replay->events * 1e9 / elapsed,
+				(double) elapsed / replay->events);
+	}
+	if (config->debounce.mode != DEBOUNCE_OFF)
+		printf("[replay] %llu edges debounced\n", (unsigned long long) debounced);
+	latency_format(&replay->handoff, threaded ? "threads" : "loop", line,
+			sizeof(line));
+	printf("[replay] read to written, %s", line);
+	if (threaded)
+		printf(", %llu stalls",
+				(unsigned long long) atomic_load(&replay->ring.stalls));
+	printf("\n");
+
+	replay_close(gpads, units * playersPerUnit, &kbd);
+	free(sticks);
+	free(replay->state);
+	timer_sched_close(&replay->sched);
+	trace_close(&replay->trace);
+	free(replay);
+	return result;
+}
+
+// supplementary functions -------------------
+
+static void replay_close(UINP_GPAD_DEV *gpads, int gpadsnum,
+		UINP_KBD_DEV* const kbd) {
+	int ctr;
+
+	for (ctr = 0; ctr < gpadsnum; ctr++)
+		uinput_gpad_close(&gpads[ctr]);
+	uinput_kbd_close(kbd);
+	free(gpads);
+}
+
+/* translates one batch, read is when it was taken from the recording.
+ * With more, the rest of it follows in the next call and the whole batch
+ * is written then. */
+static void replay_batch(REPLAY* const replay, uint16_t unit,
+		const struct input_event *ev, uint16_t count, uint64_t read,
+		uint8_t more) {
+	if (unit >= replay->units || count == 0)
+		return;
+	/* deferred events run in recorded time, the clock of the stick */
+	replay->last = latency_timeval_ns(&ev[count - 1].time);
+	if (!replay->continued && timer_sched_advance(&replay->sched,
+			latency_timeval_ns(&ev[0].time)) > 0)
+		translate_flush(&replay->ctx);
+	translate_queue_events(&replay->ctx, &replay->state[unit], ev, count);
+	replay->continued = more;
+	if (more)
+		return;
+	translate_flush(&replay->ctx);
+	latency_record(&replay->handoff, latency_now() - read);
+}
+
+/* lets pending taps finish, releases what is still held and turns the
+ * clock back, so the next loop translates like the first one did */
+static void replay_loop_end(REPLAY* const replay) {
+	int ctr;
+
+	timer_sched_advance(&replay->sched, replay->last + 1000000000ULL);
+	translate_flush(&replay->ctx);
+	for (ctr = 0; ctr < replay->units; ctr++)
+		translate_release_all(&replay->ctx, &replay->state[ctr]);
+	translate_flush(&replay->ctx);
+	timer_sched_open_virtual(&replay->sched, 0);
+}
+
+/* reads and translates in turn, like the main loop without --threads */
+static int16_t replay_direct(REPLAY* const replay) {
+	const TRACE_BATCH *batch;
+	const struct input_event *ev;
+	uint32_t loop;
+	int16_t count = 0;
+
+	for (loop = 0; loop < replay->loops; loop++) {
+		trace_rewind(&replay->trace);
+		while ((count = trace_next(&replay->trace, &batch, &ev)) > 0) {
+			replay_batch(replay, batch->unit, ev, count, latency_now(), 0);
+			replay->batches++;
+			replay->events += count;
+		}
+		if (count < 0)
+			printf("[replay] The recording is truncated\n");
+		replay_loop_end(replay);
+	}
+	return 0;
+}
+
+/* a producer thread reads the recording into a ring as fast as it can,
+ * this thread waits on the eventfd and translates what arrives */
+static int16_t replay_threads(REPLAY* const replay) {
+	const PIPELINE_SLOT *slot;
+	pthread_attr_t attr;
+	pthread_t producer;
+	int16_t result = 0;
+	int done = 0;
+
+	pipeline_ring_init(&replay->ring);
+	replay->wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (replay->wakefd < 0) {
+		printf("[replay] Unable to create an eventfd: %s\n", strerror(errno));
+		return -1;
+	}
+	pthread_attr_init(&attr);
+	pthread_attr_setstacksize(&attr, PIPELINE_STACK_SIZE);
+	result = pthread_create(&producer, &attr, replay_produce, replay);
+	pthread_attr_destroy(&attr);
+	if (result != 0) {
+		printf("[replay] Unable to start the producer thread\n");
+		close(replay->wakefd);
+		return -1;
+	}
+
+	while (!done) {
+		if (pipeline_wait(replay->wakefd) != 0) {
+			result = -1;
+			break;
+		}
+		while (!done && (slot = pipeline_ring_peek(&replay->ring)) != NULL) {
+			if (slot->kind == PIPELINE_KIND_EVENTS)
+				replay_batch(replay, slot->unit, slot->ev, slot->count,
+						slot->read, slot->more);
+			else if (slot->kind == PIPELINE_KIND_MARK)
+				replay_loop_end(replay);
+			else
+				done = 1;
+			pipeline_ring_release(&replay->ring);
+		}
+	}
+
+	pthread_join(producer, NULL);
+	close(replay->wakefd);
+	return result;
+}
+
+static void *replay_produce(void *arg) {
+	REPLAY *replay = arg;
+	const TRACE_BATCH *batch;
+	const struct input_event *ev;
+	uint32_t loop;
+	int16_t count = 0;
+
+	for (loop = 0; loop < replay->loops; loop++) {
+		trace_rewind(&replay->trace);
+		while ((count = trace_next(&replay->trace, &batch, &ev)) > 0) {
+			pipeline_push(&replay->ring, PIPELINE_KIND_EVENTS, batch->unit, ev,
+					count, latency_now(), replay->wakefd, -1);
+			replay->batches++;
+			replay->events += count;
+		}
+		if (count < 0)
+			printf("[replay] The recording is truncated\n");
+		pipeline_push(&replay->ring, PIPELINE_KIND_MARK, 0, NULL, 0,
+				latency_now(), replay->wakefd, -1);
+	}
+	pipeline_push(&replay->ring, PIPELINE_KIND_CLOSED, 0, NULL, 0,
+			latency_now(), replay->wakefd, -1);
+	return NULL;
+}
@@ -0,0 +1,81 @@
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 2014, Florian Mueller                      */
+/* ======================================================================== */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "rt.h"
+
+// declaration of supplementary functions  -------------------
+static void rt_prefault_stack(void);
+
+// relizations ----------------------
+void rt_set_default(RT_PARAMS* const params) {
+	params->priority = RT_PRIORITY_DEFAULT;
+	params->cpu = -1;
+}
+
+/* pins the process, locks its memory and switches it to SCHED_FIFO. Meant
+ * to run once all devices are set up, every step is tried even if one
+ * before failed, -1 tells that at least one did. */
+int16_t rt_enter(const RT_PARAMS* const params) {
+	struct sched_param sp;
+	cpu_set_t cpus;
+	int16_t result = 0;
+
+	if (params->cpu >= 0) {
+		CPU_ZERO(&cpus);
+		CPU_SET(params->cpu, &cpus);
+		if (sched_setaffinity(0, sizeof(cpus), &cpus) != 0) {
+			printf("[rt] Unable to pin to CPU %d: %s\n", params->cpu,
+					strerror(errno));
+			result = -1;
+		}
+	}
+
+	if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+		printf("[rt] Unable to lock memory: %s\n", strerror(errno));
+		result = -1;
+	} else {
+		rt_prefault_stack();
+	}
+
+	memset(&sp, 0, sizeof(sp));
+	sp.sched_priority = params->priority;
+	if (sched_setscheduler(0, SCHED_FIFO, &sp) != 0) {
+		printf("[rt] Unable to set SCHED_FIFO priority %d: %s\n",
+				params->priority, strerror(errno));
+		result = -1;
+	}
+	return result;
+}
+
+// supplementary functions -------------------
+
+/* with MCL_FUTURE the touched pages stay resident */
+static void rt_prefault_stack(void) {
+	volatile uint8_t stack[RT_STACK_PREFAULT];
+	size_t ctr;
+
+	for (ctr = 0; ctr < sizeof(stack); ctr += 4096)
+		stack[ctr] = 0;
+}
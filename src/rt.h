@@ -0,0 +1,40 @@
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 2014, Florian Mueller                      */
+/* ======================================================================== */
+
+#ifndef RT_H_
+#define RT_H_
+
+#include <stdint.h>
+
+#define RT_PRIORITY_DEFAULT 50
+/* CPU_SETSIZE of glibc */
+#define RT_CPUS_MAX 1024
+/* stack touched up front, so the hot path never faults it in */
+#define RT_STACK_PREFAULT (256 * 1024)
+
+typedef struct {
+	/* SCHED_FIFO priority, 1..99 */
+	uint8_t priority;
+	/* CPU to pin to, -1 for no pinning */
+	int16_t cpu;
+} RT_PARAMS;
+
+void rt_set_default(RT_PARAMS* const params);
+int16_t rt_enter(const RT_PARAMS* const params);
+
+#endif /* RT_H_ */
@@ -0,0 +1,104 @@
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 2014, Florian Mueller                      */
+/* ======================================================================== */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "state_page.h"
+
+// relizations ----------------------
+/* creates the page at path, a file in /dev/shm that anyone may map for
+ * reading. Updates are plain stores into the mapping, no system calls. */
+int16_t state_page_open(STATE_PAGE_WRITER* const writer, const char *path,
+		uint32_t units, uint32_t devs) {
+	size_t unitOffset = (sizeof(STATE_PAGE) + 7) & ~7;
+	size_t devOffset = (unitOffset + units * sizeof(STATE_PAGE_UNIT) + 7) & ~7;
+	size_t size = devOffset + devs * sizeof(STATE_PAGE_DEV);
+	void *map;
+
+	writer->page = NULL;
+	snprintf(writer->path, sizeof(writer->path), "%s", path);
+	/* /dev/shm is world writable, so never open what someone else put at
+	 * path: remove it and insist on creating a fresh file */
+	if (unlink(path) != 0 && errno != ENOENT) {
+		printf("[state_page] Unable to remove %s: %s\n", path, strerror(errno));
+		writer->fd = -1;
+		return -1;
+	}
+	writer->fd = open(path, O_RDWR | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC,
+			0644);
+	if (writer->fd < 0 || fchmod(writer->fd, 0644) != 0
+			|| ftruncate(writer->fd, size) != 0) {
+		printf("[state_page] Unable to create %s: %s\n", path, strerror(errno));
+		state_page_close(writer);
+		return -1;
+	}
+	map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, writer->fd, 0);
+	if (map == MAP_FAILED) {
+		printf("[state_page] Unable to map %s: %s\n", path, strerror(errno));
+		state_page_close(writer);
+		return -1;
+	}
+
+	/* the file is fresh and zeroed, the header is the only content yet */
+	writer->page = map;
+	writer->page->magic = STATE_PAGE_MAGIC;
+	writer->page->version = STATE_PAGE_VERSION;
+	writer->page->size = size;
+	writer->page->units = units;
+	writer->page->devs = devs;
+	writer->page->unitOffset = unitOffset;
+	writer->page->devOffset = devOffset;
+	atomic_init(&writer->page->seq, 0);
+	writer->statsDue = 0;
+	return 0;
+}
+
+/* readers retry until state_page_end() */
+STATE_PAGE *state_page_begin(STATE_PAGE_WRITER* const writer) {
+	uint_least32_t seq = atomic_load_explicit(&writer->page->seq,
+			memory_order_relaxed);
+
+	atomic_store_explicit(&writer->page->seq, seq + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	return writer->page;
+}
+
+void state_page_end(STATE_PAGE_WRITER* const writer, uint64_t now) {
+	uint_least32_t seq = atomic_load_explicit(&writer->page->seq,
+			memory_order_relaxed);
+
+	writer->page->updated = now;
+	atomic_store_explicit(&writer->page->seq, seq + 1, memory_order_release);
+}
+
+void state_page_close(STATE_PAGE_WRITER* const writer) {
+	if (writer->page != NULL)
+		munmap(writer->page, writer->page->size);
+	writer->page = NULL;
+	if (writer->fd < 0)
+		return;
+	close(writer->fd);
+	unlink(writer->path);
+	writer->fd = -1;
+}
@@ -0,0 +1,92 @@
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 2014, Florian Mueller                      */
+/* ======================================================================== */
+
+#ifndef STATE_PAGE_H_
+#define STATE_PAGE_H_
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <linux/input.h>
+
+#include "latency.h"
+
+/* default path of the state page */
+#define STATE_PAGE_PATH "/dev/shm/xarcade2jstick"
+#define STATE_PAGE_MAGIC 0x53324a58
+#define STATE_PAGE_VERSION 1
+/* how often the latency figures are worked out again, in ns */
+#define STATE_PAGE_STATS_NS 100000000ULL
+
+/* one stick */
+typedef struct {
+	/* bit per key code held on the stick */
+	uint8_t keys[KEY_CNT / 8];
+	uint8_t attached;
+	/* presses per key code that made it through the debounce filter */
+	uint32_t presses[KEY_CNT];
+} STATE_PAGE_UNIT;
+
+/* one virtual device */
+typedef struct {
+	/* direction of every axis of a gamepad, -1, 0 or 1 */
+	int8_t axes[ABS_CNT];
+	/* from stick event to write, see STATE_PAGE_STATS_NS */
+	LATENCY_STATS latency;
+	/* events written, SYN_REPORTs included */
+	uint64_t sent;
+} STATE_PAGE_DEV;
+
+/* the start of the shared file. A reader loads seq, waits while it is odd,
+ * copies what it needs and loads seq again: if it changed in between,
+ * the copy is torn and has to be taken again. */
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t size;
+	uint32_t units;
+	/* gamepads, the keyboard is the last one */
+	uint32_t devs;
+	/* from the start of the page */
+	uint32_t unitOffset;
+	uint32_t devOffset;
+	atomic_uint_least32_t seq;
+	/* monotonic time of the last update in ns */
+	uint64_t updated;
+} STATE_PAGE;
+
+#define STATE_PAGE_UNITS(page) \
+	((STATE_PAGE_UNIT *) ((char *) (page) + (page)->unitOffset))
+#define STATE_PAGE_DEVS(page) \
+	((STATE_PAGE_DEV *) ((char *) (page) + (page)->devOffset))
+
+/* the daemon's side of the page */
+typedef struct {
+	int fd;
+	char path[108];
+	STATE_PAGE *page;
+	/* when the latency figures are due again */
+	uint64_t statsDue;
+} STATE_PAGE_WRITER;
+
+int16_t state_page_open(STATE_PAGE_WRITER* const writer, const char *path,
+		uint32_t units, uint32_t devs);
+STATE_PAGE *state_page_begin(STATE_PAGE_WRITER* const writer);
+void state_page_end(STATE_PAGE_WRITER* const writer, uint64_t now);
+void state_page_close(STATE_PAGE_WRITER* const writer);
+
+#endif /* STATE_PAGE_H_ */
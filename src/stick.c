@@ -0,0 +1,80 @@
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 2014, Florian Mueller                      */
+/* ======================================================================== */
+
+#include <string.h>
+
+#include "stick.h"
+
+// declaration of supplementary functions  -------------------
+static int8_t stick_resolve(const STICK_AXIS* const axis, STICK_SOCD_E mode);
+
+// relizations ----------------------
+void stick_reset(STICK* const stick) {
+	memset(stick, 0, sizeof(*stick));
+}
+
+/* applies a press or release of one side of an axis. Returns 1 and the new
+ * direction in dir if the resolved direction changed, 0 if nothing needs
+ * to be sent and -1 for an axis out of range. */
+int16_t stick_update(STICK* const stick, uint16_t axis, uint8_t side,
+		uint8_t pressed, STICK_SOCD_E mode, int8_t *dir) {
+	STICK_AXIS *state;
+	int8_t resolved;
+
+	if (axis >= ABS_CNT || side > STICK_SIDE_MAX)
+		return -1;
+	state = &stick->axis[axis];
+
+	if (pressed) {
+		if (state->held[side] == 0 && state->held[!side] == 0)
+			state->first = side;
+		state->held[side]++;
+		state->last = side;
+	} else if (state->held[side] > 0) {
+		state->held[side]--;
+		/* the side still held is the only one left, so it counts as first */
+		if (state->held[side] == 0)
+			state->first = !side;
+	}
+
+	resolved = stick_resolve(state, mode);
+	if (resolved == state->dir)
+		return 0;
+	state->dir = resolved;
+	*dir = resolved;
+	return 1;
+}
+
+// supplementary functions -------------------
+
+static int8_t stick_resolve(const STICK_AXIS* const axis, STICK_SOCD_E mode) {
+	uint8_t side;
+
+	if (axis->held[STICK_SIDE_MIN] && axis->held[STICK_SIDE_MAX]) {
+		if (mode == STICK_SOCD_NEUTRAL)
+			return 0;
+		side = mode == STICK_SOCD_FIRST ? axis->first : axis->last;
+	} else if (axis->held[STICK_SIDE_MIN]) {
+		side = STICK_SIDE_MIN;
+	} else if (axis->held[STICK_SIDE_MAX]) {
+		side = STICK_SIDE_MAX;
+	} else {
+		return 0;
+	}
+	return side == STICK_SIDE_MIN ? -1 : 1;
+}
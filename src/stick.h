@@ -0,0 +1,54 @@
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 2014, Florian Mueller                      */
+/* ======================================================================== */
+
+#ifndef STICK_H_
+#define STICK_H_
+
+#include <stdint.h>
+#include <linux/input.h>
+
+/* what a digital stick reports while both sides of an axis are held */
+typedef enum {
+	STICK_SOCD_LAST = 0,	// the side pressed last wins
+	STICK_SOCD_NEUTRAL = 1,	// the axis goes to its center
+	STICK_SOCD_FIRST = 2	// the side held first keeps winning
+} STICK_SOCD_E;
+
+/* sides of an axis, index into held[] */
+#define STICK_SIDE_MIN 0
+#define STICK_SIDE_MAX 1
+
+typedef struct {
+	/* keys held per side, several keys may drive the same side */
+	uint8_t held[2];
+	uint8_t last;
+	uint8_t first;
+	/* direction last reported, -1, 0 or 1 */
+	int8_t dir;
+} STICK_AXIS;
+
+/* held directions of one virtual gamepad */
+typedef struct {
+	STICK_AXIS axis[ABS_CNT];
+} STICK;
+
+void stick_reset(STICK* const stick);
+int16_t stick_update(STICK* const stick, uint16_t axis, uint8_t side,
+		uint8_t pressed, STICK_SOCD_E mode, int8_t *dir);
+
+#endif /* STICK_H_ */
@@ -0,0 +1,202 @@
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 2014, Florian Mueller                      */
+/* ======================================================================== */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+
+#include "latency.h"
+#include "logger.h"
+#include "timer_sched.h"
+
+// declaration of supplementary functions  -------------------
+static int16_t timer_sched_arm(TIMER_SCHED* const sched);
+static int16_t timer_sched_run(TIMER_SCHED* const sched, uint64_t now);
+
+// relizations ----------------------
+int16_t timer_sched_open(TIMER_SCHED* const sched) {
+	memset(sched, 0, sizeof(*sched));
+	sched->fd = timerfd_create(LATENCY_CLOCK, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (sched->fd < 0) {
+		printf("[timer_sched] Unable to create timerfd: %s\n", strerror(errno));
+		return -1;
+	}
+	return 0;
+}
+
+/* a scheduler driven by timer_sched_advance() instead of a timerfd */
+int16_t timer_sched_open_virtual(TIMER_SCHED* const sched, uint64_t start) {
+	memset(sched, 0, sizeof(*sched));
+	sched->fd = -1;
+	sched->vnow = start ? start : 1;
+	return 0;
+}
+
+int16_t timer_sched_close(TIMER_SCHED* const sched) {
+	int result = sched->fd < 0 ? 0 : close(sched->fd);
+	sched->fd = -1;
+	return result;
+}
+
+/* queues fn(ctx, evtype, keycode, keyvalue) to be called delay_us from now */
+int16_t timer_sched_add(TIMER_SCHED* const sched, uint32_t delay_us,
+		TIMER_SCHED_FN fn, void *ctx, uint16_t evtype, uint16_t keycode,
+		int32_t keyvalue) {
+	return timer_sched_add_at(sched,
+			timer_sched_clock(sched) + (uint64_t) delay_us * 1000, fn, ctx,
+			evtype, keycode, keyvalue);
+}
+
+/* like timer_sched_add(), at the monotonic time due in ns. A time that
+ * has passed already runs with the next dispatch. */
+int16_t timer_sched_add_at(TIMER_SCHED* const sched, uint64_t due,
+		TIMER_SCHED_FN fn, void *ctx, uint16_t evtype, uint16_t keycode,
+		int32_t keyvalue) {
+	TIMER_SCHED_EVT *evt;
+	int ctr;
+
+	for (ctr = 0; ctr < TIMER_SCHED_LEN; ctr++) {
+		evt = &sched->evts[ctr];
+		if (evt->used)
+			continue;
+		evt->due = due;
+		evt->fn = fn;
+		evt->ctx = ctx;
+		evt->evtype = evtype;
+		evt->keycode = keycode;
+		evt->keyvalue = keyvalue;
+		evt->used = 1;
+		return timer_sched_arm(sched);
+	}
+	LOGGER(LOG_WARNING, "[timer_sched] Too many pending events");
+	return -1;
+}
+
+/* drops pending events matching fn, ctx and keycode, returns how many */
+int16_t timer_sched_cancel(TIMER_SCHED* const sched, TIMER_SCHED_FN fn,
+		void *ctx, uint16_t keycode) {
+	TIMER_SCHED_EVT *evt;
+	int16_t cancelled = 0;
+	int ctr;
+
+	for (ctr = 0; ctr < TIMER_SCHED_LEN; ctr++) {
+		evt = &sched->evts[ctr];
+		if (evt->used && evt->fn == fn && evt->ctx == ctx
+				&& evt->keycode == keycode) {
+			evt->used = 0;
+			cancelled++;
+		}
+	}
+	if (cancelled)
+		timer_sched_arm(sched);
+	return cancelled;
+}
+
+/* runs all events that are due, call when the timerfd becomes readable */
+int16_t timer_sched_dispatch(TIMER_SCHED* const sched) {
+	uint64_t expirations;
+
+	/* only resets the readable state, the due times are checked below */
+	if (read(sched->fd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN)
+		return -errno;
+
+	sched->armed = 0;
+	return timer_sched_run(sched, latency_now());
+}
+
+/* moves the simulated clock of a virtual scheduler and runs what became
+ * due. Events run one by one in the order of their due time, each one
+ * with the clock at that time, so events they queue in turn run too. */
+int16_t timer_sched_advance(TIMER_SCHED* const sched, uint64_t now) {
+	TIMER_SCHED_EVT *evt, *first;
+	int16_t fired = 0;
+	int ctr;
+
+	for (;;) {
+		first = NULL;
+		for (ctr = 0; ctr < TIMER_SCHED_LEN; ctr++) {
+			evt = &sched->evts[ctr];
+			if (evt->used && evt->due <= now
+					&& (first == NULL || evt->due < first->due))
+				first = evt;
+		}
+		if (first == NULL)
+			break;
+		if (first->due > sched->vnow)
+			sched->vnow = first->due;
+		first->used = 0;
+		first->fn(first->ctx, first->evtype, first->keycode, first->keyvalue);
+		fired++;
+	}
+	if (now > sched->vnow)
+		sched->vnow = now;
+	return fired;
+}
+
+/* the time of the scheduler, simulated or real, in nanoseconds */
+uint64_t timer_sched_clock(const TIMER_SCHED* const sched) {
+	return sched->vnow ? sched->vnow : latency_now();
+}
+
+// supplementary functions -------------------
+
+static int16_t timer_sched_run(TIMER_SCHED* const sched, uint64_t now) {
+	TIMER_SCHED_EVT *evt;
+	int16_t fired = 0;
+	int ctr;
+
+	for (ctr = 0; ctr < TIMER_SCHED_LEN; ctr++) {
+		evt = &sched->evts[ctr];
+		if (!evt->used || evt->due > now)
+			continue;
+		evt->used = 0;
+		evt->fn(evt->ctx, evt->evtype, evt->keycode, evt->keyvalue);
+		fired++;
+	}
+	timer_sched_arm(sched);
+	return fired;
+}
+
+/* programs the timerfd for the earliest pending event as an absolute time */
+static int16_t timer_sched_arm(TIMER_SCHED* const sched) {
+	struct itimerspec its;
+	uint64_t next = 0;
+	int ctr;
+
+	for (ctr = 0; ctr < TIMER_SCHED_LEN; ctr++) {
+		if (sched->evts[ctr].used
+				&& (next == 0 || sched->evts[ctr].due < next))
+			next = sched->evts[ctr].due;
+	}
+	if (next == sched->armed || sched->fd < 0)
+		return 0;
+
+	/* an all-zero it_value disarms the timer */
+	memset(&its, 0, sizeof(its));
+	its.it_value.tv_sec = next / 1000000000ULL;
+	its.it_value.tv_nsec = next % 1000000000ULL;
+	if (timerfd_settime(sched->fd, TFD_TIMER_ABSTIME, &its, NULL) < 0) {
+		LOGGER(LOG_ERR, "[timer_sched] Unable to arm timerfd: %s", strerror(errno));
+		return -1;
+	}
+	sched->armed = next;
+	return 0;
+}
@@ -0,0 +1,63 @@
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 2014, Florian Mueller                      */
+/* ======================================================================== */
+
+#ifndef TIMER_SCHED_H_
+#define TIMER_SCHED_H_
+
+#include <stdint.h>
+
+/* maximum number of pending deferred events */
+#define TIMER_SCHED_LEN 64
+
+typedef void (*TIMER_SCHED_FN)(void *ctx, uint16_t evtype, uint16_t keycode,
+		int32_t keyvalue);
+
+typedef struct {
+	uint64_t due;
+	TIMER_SCHED_FN fn;
+	void *ctx;
+	uint16_t evtype;
+	uint16_t keycode;
+	int32_t keyvalue;
+	uint8_t used;
+} TIMER_SCHED_EVT;
+
+typedef struct {
+	int fd;
+	uint64_t armed;
+	/* simulated time for replays without a timerfd, 0 uses the real clock */
+	uint64_t vnow;
+	TIMER_SCHED_EVT evts[TIMER_SCHED_LEN];
+} TIMER_SCHED;
+
+int16_t timer_sched_open(TIMER_SCHED* const sched);
+int16_t timer_sched_open_virtual(TIMER_SCHED* const sched, uint64_t start);
+int16_t timer_sched_close(TIMER_SCHED* const sched);
+int16_t timer_sched_add(TIMER_SCHED* const sched, uint32_t delay_us,
+		TIMER_SCHED_FN fn, void *ctx, uint16_t evtype, uint16_t keycode,
+		int32_t keyvalue);
+int16_t timer_sched_add_at(TIMER_SCHED* const sched, uint64_t due,
+		TIMER_SCHED_FN fn, void *ctx, uint16_t evtype, uint16_t keycode,
+		int32_t keyvalue);
+int16_t timer_sched_cancel(TIMER_SCHED* const sched, TIMER_SCHED_FN fn,
+		void *ctx, uint16_t keycode);
+int16_t timer_sched_dispatch(TIMER_SCHED* const sched);
+int16_t timer_sched_advance(TIMER_SCHED* const sched, uint64_t now);
+uint64_t timer_sched_clock(const TIMER_SCHED* const sched);
+
+#endif /* TIMER_SCHED_H_ */
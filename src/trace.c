@@ -0,0 +1,160 @@
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 2014, Florian Mueller                      */
+/* ======================================================================== */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#include "logger.h"
+#include "trace.h"
+#include "latency.h"
+
+// relizations ----------------------
+/* starts a new recording, an existing file is replaced */
+int16_t trace_create(TRACE* const trace, const char *path) {
+	TRACE_HEADER header;
+
+	memset(trace, 0, sizeof(*trace));
+	trace->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (trace->fd < 0) {
+		printf("[trace] Unable to create %s: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+	header.version = TRACE_VERSION;
+	header.header_size = sizeof(header);
+	header.event_size = sizeof(struct input_event);
+	header.start = latency_now();
+	if (write(trace->fd, &header, sizeof(header)) != sizeof(header)) {
+		printf("[trace] Unable to write %s: %s\n", path, strerror(errno));
+		close(trace->fd);
+		trace->fd = -1;
+		return -1;
+	}
+	return 0;
+}
+
+/* appends one read batch with a single syscall */
+int16_t trace_write(TRACE* const trace, uint16_t unit,
+		const struct input_event *ev, uint16_t count) {
+	TRACE_BATCH batch;
+	struct iovec iov[2];
+
+	memset(&batch, 0, sizeof(batch));
+	batch.unit = unit;
+	batch.count = count;
+	iov[0].iov_base = &batch;
+	iov[0].iov_len = sizeof(batch);
+	iov[1].iov_base = (void *) ev;
+	iov[1].iov_len = sizeof(struct input_event) * count;
+	if (writev(trace->fd, iov, 2) < 0) {
+		LOGGER(LOG_ERR, "[trace] Unable to write: %s", strerror(errno));
+		return -1;
+	}
+	return 0;
+}
+
+/* maps a recording for reading */
+int16_t trace_open(TRACE* const trace, const char *path) {
+	const TRACE_HEADER *header;
+	struct stat st;
+	void *map;
+
+	memset(trace, 0, sizeof(*trace));
+	trace->fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (trace->fd < 0 || fstat(trace->fd, &st) < 0) {
+		printf("[trace] Unable to open %s: %s\n", path, strerror(errno));
+		trace_close(trace);
+		return -1;
+	}
+	if (st.st_size < sizeof(TRACE_HEADER)) {
+		printf("[trace] %s is no recording\n", path);
+		trace_close(trace);
+		return -1;
+	}
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, trace->fd, 0);
+	if (map == MAP_FAILED) {
+		printf("[trace] Unable to map %s: %s\n", path, strerror(errno));
+		trace_close(trace);
+		return -1;
+	}
+	trace->map = map;
+	trace->size = st.st_size;
+
+	header = (const TRACE_HEADER *) trace->map;
+	if (memcmp(header->magic, TRACE_MAGIC, sizeof(header->magic)) != 0
+			|| header->version != TRACE_VERSION
+			|| header->header_size < sizeof(TRACE_HEADER)
+			|| header->header_size > trace->size
+			|| header->header_size % 8 != 0) {
+		printf("[trace] %s is no recording of this version\n", path);
+		trace_close(trace);
+		return -1;
+	}
+	if (header->event_size != sizeof(struct input_event)) {
+		printf("[trace] %s was recorded with %u byte events, this machine uses %u\n",
+				path, header->event_size, (unsigned int) sizeof(struct input_event));
+		trace_close(trace);
+		return -1;
+	}
+	trace_rewind(trace);
+	return 0;
+}
+
+/* returns the event count of the next batch, 0 at the end or -1 if truncated */
+int16_t trace_next(TRACE* const trace, const TRACE_BATCH **batch,
+		const struct input_event **ev) {
+	const TRACE_BATCH *next;
+
+	if (trace->pos == trace->size)
+		return 0;
+	if (trace->size - trace->pos < sizeof(TRACE_BATCH))
+		return -1;
+	next = (const TRACE_BATCH *) (trace->map + trace->pos);
+	if (trace->size - trace->pos - sizeof(TRACE_BATCH)
+			< sizeof(struct input_event) * next->count)
+		return -1;
+
+	*batch = next;
+	*ev = (const struct input_event *) (next + 1);
+	trace->pos += sizeof(TRACE_BATCH) + sizeof(struct input_event) * next->count;
+	return next->count;
+}
+
+void trace_rewind(TRACE* const trace) {
+	trace->pos = ((const TRACE_HEADER *) trace->map)->header_size;
+}
+
+int16_t trace_close(TRACE* const trace) {
+	if (trace->map != NULL)
+		munmap((void *) trace->map, trace->size);
+	trace->map = NULL;
+	if (trace->fd < 0)
+		return 0;
+	close(trace->fd);
+	trace->fd = -1;
+	return 0;
+}
@@ -0,0 +1,65 @@
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 2014, Florian Mueller                      */
+/* ======================================================================== */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <linux/input.h>
+
+#define TRACE_MAGIC "X2JTRACE"
+#define TRACE_VERSION 1
+
+/* file layout: header, then per read batch a TRACE_BATCH followed by its
+ * events exactly as returned by input_xarcade_read(). All parts are
+ * multiples of 8 bytes, so a mapped file can be used in place. */
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint32_t header_size;
+	/* sizeof(struct input_event) of the recording machine */
+	uint32_t event_size;
+	uint32_t reserved;
+	/* CLOCK_MONOTONIC in ns when the recording started */
+	uint64_t start;
+} TRACE_HEADER;
+
+typedef struct {
+	uint16_t unit;
+	uint16_t count;
+	uint32_t reserved;
+} TRACE_BATCH;
+
+typedef struct {
+	int fd;
+	const uint8_t *map;
+	size_t size;
+	size_t pos;
+} TRACE;
+
+int16_t trace_create(TRACE* const trace, const char *path);
+int16_t trace_write(TRACE* const trace, uint16_t unit,
+		const struct input_event *ev, uint16_t count);
+int16_t trace_open(TRACE* const trace, const char *path);
+int16_t trace_next(TRACE* const trace, const TRACE_BATCH **batch,
+		const struct input_event **ev);
+void trace_rewind(TRACE* const trace);
+int16_t trace_close(TRACE* const trace);
+
+#endif /* TRACE_H_ */
@@ -0,0 +1,556 @@
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 2014, Florian Mueller                      */
+/* ======================================================================== */
+
+#include <string.h>
+
+#include "translate.h"
+
+typedef void (*TRANSLATE_ACTION_FN)(TRANSLATE_CTX* const ctx,
+		TRANSLATE_UNIT* const unit, const KEYMAP_ENTRY *entry, int32_t value);
+
+// declaration of supplementary functions  -------------------
+static void actionNone(TRANSLATE_CTX* const ctx, TRANSLATE_UNIT* const unit,
+		const KEYMAP_ENTRY *entry, int32_t value);
+static void actionGpadKey(TRANSLATE_CTX* const ctx, TRANSLATE_UNIT* const unit,
+		const KEYMAP_ENTRY *entry, int32_t value);
+static void actionGpadAbs(TRANSLATE_CTX* const ctx, TRANSLATE_UNIT* const unit,
+		const KEYMAP_ENTRY *entry, int32_t value);
+static void actionGpadTap(TRANSLATE_CTX* const ctx, TRANSLATE_UNIT* const unit,
+		const KEYMAP_ENTRY *entry, int32_t value);
+static void actionKbdKey(TRANSLATE_CTX* const ctx, TRANSLATE_UNIT* const unit,
+		const KEYMAP_ENTRY *entry, int32_t value);
+static void actionKbdTap(TRANSLATE_CTX* const ctx, TRANSLATE_UNIT* const unit,
+		const KEYMAP_ENTRY *entry, int32_t value);
+static void outputKeyTap(TRANSLATE_CTX* const ctx, UINP_GPAD_DEV *gpad,
+		int keyCode);
+static void outputKbdTap(TRANSLATE_CTX* const ctx, int keyCode);
+static void translateEvent(TRANSLATE_CTX* const ctx, TRANSLATE_UNIT* const unit,
+		int code, int value);
+static void translateKey(TRANSLATE_CTX* const ctx, TRANSLATE_UNIT* const unit,
+		int code, int value);
+static const KEYMAP_ENTRY *lookupKey(const KEYMAP *keymap, int code,
+		KEYMAP_ENTRY *pass);
+static int debounceKey(TRANSLATE_CTX* const ctx, TRANSLATE_UNIT* const unit,
+		int code, int value);
+static void debounceSettled(void *ctx, uint16_t evtype, uint16_t keyCode,
+		int32_t value);
+static int turboKey(TRANSLATE_CTX* const ctx, TRANSLATE_UNIT* const unit,
+		const KEYMAP_ENTRY *entry, int code, int value);
+static void turboSchedule(TRANSLATE_CTX* const ctx, TRANSLATE_UNIT* const unit);
+static void turboTick(void *ctx, uint16_t evtype, uint16_t keyCode,
+		int32_t value);
+static int translateChordKey(TRANSLATE_CTX* const ctx,
+		TRANSLATE_UNIT* const unit, int code, int value);
+static int findChord(const KEYMAP *keymap, const TRANSLATE_UNIT* const unit,
+		int code);
+static int chordHasKey(const KEYMAP_CHORD* const chord, int code);
+static void fireChord(TRANSLATE_CTX* const ctx, TRANSLATE_UNIT* const unit,
+		int chord, int code);
+static void chordAction(TRANSLATE_CTX* const ctx, TRANSLATE_UNIT* const unit,
+		int chord, int value);
+static int findPending(const TRANSLATE_UNIT* const unit, int code);
+static void removePending(TRANSLATE_CTX* const ctx, TRANSLATE_UNIT* const unit,
+		int pending);
+static void chordExpired(void *ctx, uint16_t evtype, uint16_t keyCode,
+		int32_t value);
+
+/* handlers for the keymap actions, value is already transformed by the keymap */
+static const TRANSLATE_ACTION_FN keymapActions[KEYMAP_ACTION_CNT] = {
+	[KEYMAP_ACTION_NONE] = actionNone,
+	[KEYMAP_ACTION_GPAD_KEY] = actionGpadKey,
+	[KEYMAP_ACTION_GPAD_ABS] = actionGpadAbs,
+	[KEYMAP_ACTION_GPAD_TAP] = actionGpadTap,
+	[KEYMAP_ACTION_KBD_KEY] = actionKbdKey,
+	[KEYMAP_ACTION_KBD_TAP] = actionKbdTap,
+};
+
+// relizations ----------------------
+void translate_unit_init(TRANSLATE_UNIT* const unit, TRANSLATE_CTX* const ctx,
+		uint8_t playerOffset) {
+	memset(unit, 0, sizeof(*unit));
+	unit->ctx = ctx;
+	unit->playerOffset = playerOffset;
+}
+
+/* runs one batch read from a stick through the keymap */
+void translate_events(TRANSLATE_CTX* const ctx, TRANSLATE_UNIT* const unit,
+		const struct input_event *ev, int count) {
+	translate_queue_events(ctx, unit, ev, count);
+	translate_flush(ctx);
+}
+
+/* like translate_events() without writing, for a batch that arrives in
+ * parts. translate_flush() sends it once the last part is in. */
+void translate_queue_events(TRANSLATE_CTX* const ctx,
+		TRANSLATE_UNIT* const unit, const struct input_event *ev, int count) {
+	int ctr;
+
+	for (ctr = 0; ctr < count; ctr++) {
+		if (ev[ctr].type != EV_KEY)
+			continue;
+
+		int code = ev[ctr].code;
+		int value = ev[ctr].value > 2 ? 2 : ev[ctr].value;
+		ctx->source = latency_timeval_ns(&ev[ctr].time);
+
+		if (ctx->debounce != NULL && ctx->debounce->mode != DEBOUNCE_OFF
+				&& !debounceKey(ctx, unit, code, value))
+			continue;
+		translateEvent(ctx, unit, code, value);
+	}
+	ctx->source = 0;
+}
+
+/* releases whatever was held on the virtual devices when a stick went away */
+void translate_release_all(TRANSLATE_CTX* const ctx,
+		TRANSLATE_UNIT* const unit) {
+	const KEYMAP_ENTRY *entry;
+	KEYMAP_ENTRY pass;
+	int code;
+
+	/* edges still being debounced are forgotten, the stick reports anew */
+	for (code = 0; code < KEY_CNT; code++) {
+		if (unit->debounce.due[code] != 0)
+			timer_sched_cancel(ctx->sched, debounceSettled, unit, code);
+	}
+	debounce_reset(&unit->debounce);
+
+	/* turbo buttons are released below like any other held key */
+	timer_sched_cancel(ctx->sched, turboTick, unit, 0);
+	turbo_reset(&unit->turbo);
+
+	/* keys held back or eaten by a chord never reached the devices */
+	timer_sched_cancel(ctx->sched, chordExpired, unit, 0);
+	for (code = 0; code < unit->pendingnum; code++)
+		unit->keyStates[unit->pending[code]] = 0;
+	unit->pendingnum = 0;
+	for (code = 0; code < KEYMAP_LEN; code++) {
+		if (unit->consumed[code / 8] & (1 << (code % 8)))
+			unit->keyStates[code] = 0;
+	}
+	memset(unit->consumed, 0, sizeof(unit->consumed));
+	for (code = 0; code < ctx->keymap->chordsnum; code++) {
+		if (unit->chords[code])
+			chordAction(ctx, unit, code, 0);
+	}
+
+	for (code = 0; code < KEYMAP_LEN; code++) {
+		if (!unit->keyStates[code])
+			continue;
+		unit->keyStates[code] = 0;
+		entry = lookupKey(ctx->keymap, code, &pass);
+		if (entry->action != KEYMAP_ACTION_GPAD_TAP
+				&& entry->action != KEYMAP_ACTION_KBD_TAP)
+			keymapActions[entry->action](ctx, unit, entry, entry->value[0]);
+	}
+	translate_flush(ctx);
+}
+
+/* sends everything collected for the current batch, one frame per device */
+void translate_flush(TRANSLATE_CTX* const ctx) {
+	int ctr;
+
+	for (ctr = 0; ctr < ctx->gpadsnum; ctr++)
+		uinput_gpad_flush(&ctx->gpads[ctr]);
+	uinput_kbd_flush(ctx->kbd);
+}
+
+// supplementary functions -------------------
+
+/* a key event that made it through the debounce filter */
+static void translateEvent(TRANSLATE_CTX* const ctx, TRANSLATE_UNIT* const unit,
+		int code, int value) {
+	unit->keyStates[code] = value;
+	if (value == 1)
+		unit->presses[code]++;
+	if (KEYMAP_IS_CHORD_KEY(ctx->keymap, code)
+			&& translateChordKey(ctx, unit, code, value))
+		return;
+	translateKey(ctx, unit, code, value);
+}
+
+static void translateKey(TRANSLATE_CTX* const ctx, TRANSLATE_UNIT* const unit,
+		int code, int value) {
+	KEYMAP_ENTRY pass;
+	const KEYMAP_ENTRY *entry = lookupKey(ctx->keymap, code, &pass);
+
+	if (ctx->turbo != NULL && ctx->turbo->period[code] != 0
+			&& turboKey(ctx, unit, entry, code, value))
+		return;
+	/* a repeat that maps to the same value as the press changes nothing */
+	if (value == 2 && entry->value[2] == entry->value[1])
+		return;
+	keymapActions[entry->action](ctx, unit, entry, entry->value[value]);
+}
+
+/* the mapping of code, or a keyboard key of its own in pass if the code
+ * is unmapped and passed through */
+static const KEYMAP_ENTRY *lookupKey(const KEYMAP *keymap, int code,
+		KEYMAP_ENTRY *pass) {
+	const KEYMAP_ENTRY *entry = &keymap->map[code];
+
+	if (entry->action != KEYMAP_ACTION_NONE
+			|| !KEYMAP_IS_PASSTHROUGH(keymap, code))
+		return entry;
+	pass->action = KEYMAP_ACTION_KBD_KEY;
+	pass->player = 0;
+	pass->code = code;
+	pass->value[0] = 0;
+	pass->value[1] = 1;
+	pass->value[2] = 2;
+	return pass;
+}
+
+/* keys that are part of a chord are held back until the chord is complete
+ * or the window is over. Returns 1 if the event must not be translated
+ * as a key of its own. */
+static int translateChordKey(TRANSLATE_CTX* const ctx,
+		TRANSLATE_UNIT* const unit, int code, int value) {
+	int pending = findPending(unit, code);
+	int consumed = unit->consumed[code / 8] & (1 << (code % 8));
+	int chord;
+
+	if (value == 2)
+		return pending >= 0 || consumed;
+
+	if (value == 1) {
+		chord = findChord(ctx->keymap, unit, code);
+		if (chord >= 0) {
+			fireChord(ctx, unit, chord, code);
+			return 1;
+		}
+		/* no room left, the key goes out right away */
+		if (unit->pendingnum == TRANSLATE_PENDING_MAX)
+			return 0;
+		/* likewise without a timer to end the window */
+		if (unit->pendingnum == 0 && timer_sched_add(ctx->sched,
+				ctx->chord_window, chordExpired, unit, EV_KEY, 0, 0) != 0)
+			return 0;
+		unit->pending[unit->pendingnum] = code;
+		unit->pendingSource[unit->pendingnum++] = ctx->source;
+		return 1;
+	}
+
+	for (chord = 0; chord < ctx->keymap->chordsnum; chord++) {
+		if (unit->chords[chord] && chordHasKey(&ctx->keymap->chords[chord], code))
+			chordAction(ctx, unit, chord, 0);
+	}
+	if (consumed) {
+		unit->consumed[code / 8] &= ~(1 << (code % 8));
+		return 1;
+	}
+	if (pending >= 0) {
+		/* released within the window, the press has to go out first */
+		removePending(ctx, unit, pending);
+		translateKey(ctx, unit, code, 1);
+		translate_flush(ctx);
+	}
+	return 0;
+}
+
+/* the largest chord with code whose keys are all down, -1 if there is none */
+static int findChord(const KEYMAP *keymap, const TRANSLATE_UNIT* const unit,
+		int code) {
+	const KEYMAP_CHORD *chord;
+	int found = -1;
+	int ctr, key;
+
+	for (ctr = 0; ctr < keymap->chordsnum; ctr++) {
+		chord = &keymap->chords[ctr];
+		if (unit->chords[ctr] || !chordHasKey(chord, code))
+			continue;
+		for (key = 0; key < chord->count && unit->keyStates[chord->keys[key]]; key++)
+			;
+		if (key == chord->count
+				&& (found < 0 || chord->count > keymap->chords[found].count))
+			found = ctr;
+	}
+	return found;
+}
+
+static int chordHasKey(const KEYMAP_CHORD* const chord, int code) {
+	int key;
+
+	for (key = 0; key < chord->count; key++) {
+		if (chord->keys[key] == code)
+			return 1;
+	}
+	return 0;
+}
+
+/* code completed the chord. It and the keys of the chord that were held
+ * back are never sent, not even their releases. Keys that already went
+ * out stay down as they are. */
+static void fireChord(TRANSLATE_CTX* const ctx, TRANSLATE_UNIT* const unit,
+		int chord, int code) {
+	const KEYMAP_CHORD *def = &ctx->keymap->chords[chord];
+	int key, pending;
+
+	for (key = 0; key < def->count; key++) {
+		pending = findPending(unit, def->keys[key]);
+		if (pending >= 0)
+			removePending(ctx, unit, pending);
+		if (pending >= 0 || def->keys[key] == code)
+			unit->consumed[def->keys[key] / 8] |= 1 << (def->keys[key] % 8);
+	}
+	chordAction(ctx, unit, chord, 1);
+}
+
+/* presses or releases a chord as if it was a key of its own */
+static void chordAction(TRANSLATE_CTX* const ctx, TRANSLATE_UNIT* const unit,
+		int chord, int value) {
+	const KEYMAP_ENTRY *entry = &ctx->keymap->chords[chord].entry;
+
+	unit->chords[chord] = value;
+	keymapActions[entry->action](ctx, unit, entry, entry->value[value]);
+}
+
+static int findPending(const TRANSLATE_UNIT* const unit, int code) {
+	int ctr;
+
+	for (ctr = 0; ctr < unit->pendingnum; ctr++) {
+		if (unit->pending[ctr] == code)
+			return ctr;
+	}
+	return -1;
+}
+
+static void removePending(TRANSLATE_CTX* const ctx, TRANSLATE_UNIT* const unit,
+		int pending) {
+	unit->pendingnum--;
+	memmove(&unit->pending[pending], &unit->pending[pending + 1],
+			(unit->pendingnum - pending) * sizeof(unit->pending[0]));
+	memmove(&unit->pendingSource[pending], &unit->pendingSource[pending + 1],
+			(unit->pendingnum - pending) * sizeof(unit->pendingSource[0]));
+	if (unit->pendingnum == 0)
+		timer_sched_cancel(ctx->sched, chordExpired, unit, 0);
+}
+
+/* the window is over, the held back keys go out as plain keys */
+static void chordExpired(void *ctx, uint16_t evtype, uint16_t keyCode,
+		int32_t value) {
+	TRANSLATE_UNIT *unit = ctx;
+	TRANSLATE_CTX *translator = unit->ctx;
+	int ctr;
+
+	for (ctr = 0; ctr < unit->pendingnum; ctr++) {
+		translator->source = unit->pendingSource[ctr];
+		translateKey(translator, unit, unit->pending[ctr], 1);
+	}
+	translator->source = 0;
+	unit->pendingnum = 0;
+}
+
+/* returns 1 if the event goes on now. The window is checked at the kernel
+ * time of the edge it starts from, not when the batch is processed. */
+static int debounceKey(TRANSLATE_CTX* const ctx, TRANSLATE_UNIT* const unit,
+		int code, int value) {
+	uint64_t now = timer_sched_clock(ctx->sched);
+	uint64_t stamp = ctx->source;
+	int16_t result;
+
+	/* a stick that could not be switched to CLOCK_MONOTONIC would settle
+	 * decades from now, its edges are measured on arrival instead */
+	if (stamp + TRANSLATE_STAMP_SLACK_NS < now
+			|| stamp > now + TRANSLATE_STAMP_SLACK_NS)
+		stamp = now;
+	result = debounce_key(&unit->debounce, ctx->debounce, code, value, stamp);
+
+	if (result & DEBOUNCE_SCHEDULE) {
+		timer_sched_cancel(ctx->sched, debounceSettled, unit, code);
+		/* no room to wait, better late chatter than a lost edge */
+		if (timer_sched_add_at(ctx->sched, unit->debounce.due[code],
+				debounceSettled, unit, EV_KEY, code, 0) != 0)
+			debounceSettled(unit, EV_KEY, code, 0);
+	}
+	return result & DEBOUNCE_PASS;
+}
+
+/* the window of a key is over, its final state goes out if it changed */
+static void debounceSettled(void *ctx, uint16_t evtype, uint16_t keyCode,
+		int32_t value) {
+	TRANSLATE_UNIT *unit = ctx;
+	TRANSLATE_CTX *translator = unit->ctx;
+	uint64_t source = translator->source;
+
+	if (!debounce_settle(&unit->debounce, keyCode, &value))
+		return;
+	translator->source = unit->debounce.edge[keyCode];
+	translateEvent(translator, unit, keyCode, value);
+	translator->source = source;
+}
+
+/* presses and releases of a key with turbo. Returns 1 if the event was
+ * taken care of, 0 if it goes out as usual. */
+static int turboKey(TRANSLATE_CTX* const ctx, TRANSLATE_UNIT* const unit,
+		const KEYMAP_ENTRY *entry, int code, int value) {
+	int16_t down;
+
+	if (entry->action == KEYMAP_ACTION_NONE
+			|| entry->action == KEYMAP_ACTION_GPAD_TAP
+			|| entry->action == KEYMAP_ACTION_KBD_TAP)
+		return 0;
+	/* the turbo does the repeating */
+	if (value == 2)
+		return 1;
+
+	if (value == 1) {
+		if (turbo_press(&unit->turbo, ctx->turbo, code,
+				timer_sched_clock(ctx->sched)) != 0)
+			return 0;
+	} else {
+		down = turbo_release(&unit->turbo, code);
+		if (down < 0)
+			return 0;
+		if (down == 0) {
+			turboSchedule(ctx, unit);
+			return 1;
+		}
+	}
+	keymapActions[entry->action](ctx, unit, entry, entry->value[value]);
+	turboSchedule(ctx, unit);
+	return 1;
+}
+
+/* keeps one tick per stick scheduled for the earliest turbo edge */
+static void turboSchedule(TRANSLATE_CTX* const ctx, TRANSLATE_UNIT* const unit) {
+	uint64_t due = turbo_due(&unit->turbo);
+
+	if (due == unit->turbo.armed)
+		return;
+	if (unit->turbo.armed != 0)
+		timer_sched_cancel(ctx->sched, turboTick, unit, 0);
+	unit->turbo.armed = 0;
+	if (due != 0 && timer_sched_add_at(ctx->sched, due, turboTick, unit,
+			EV_KEY, 0, 0) == 0)
+		unit->turbo.armed = due;
+}
+
+/* flips every turbo button of the stick whose edge is due, they go out
+ * together in one frame per device */
+static void turboTick(void *ctx, uint16_t evtype, uint16_t keyCode,
+		int32_t value) {
+	TRANSLATE_UNIT *unit = ctx;
+	TRANSLATE_CTX *translator = unit->ctx;
+	uint64_t now = timer_sched_clock(translator->sched);
+	uint64_t source = translator->source;
+	const KEYMAP_ENTRY *entry;
+	KEYMAP_ENTRY pass;
+	int16_t down;
+	int idx;
+
+	latency_record(&translator->turbo_jitter, now - unit->turbo.armed);
+	unit->turbo.armed = 0;
+	translator->source = 0;
+	for (idx = 0; idx < unit->turbo.count; idx++) {
+		if (unit->turbo.next[idx] > now)
+			continue;
+		down = turbo_edge(&unit->turbo, translator->turbo, idx, now);
+		entry = lookupKey(translator->keymap, unit->turbo.code[idx], &pass);
+		keymapActions[entry->action](translator, unit, entry, entry->value[down]);
+	}
+	translator->source = source;
+	translate_flush(translator);
+	turboSchedule(translator, unit);
+}
+
+static void actionNone(TRANSLATE_CTX* const ctx, TRANSLATE_UNIT* const unit,
+		const KEYMAP_ENTRY *entry, int32_t value) {
+}
+
+static void actionGpadKey(TRANSLATE_CTX* const ctx, TRANSLATE_UNIT* const unit,
+		const KEYMAP_ENTRY *entry, int32_t value) {
+	uinput_gpad_queue(&ctx->gpads[unit->playerOffset + entry->player],
+			entry->code, value, EV_KEY, ctx->source);
+}
+
+/* directions go through the stick state, only a change of the resolved
+ * direction is sent. Whether the entry moves its axis towards the min or
+ * the max side follows from its values for release and press. */
+static void actionGpadAbs(TRANSLATE_CTX* const ctx, TRANSLATE_UNIT* const unit,
+		const KEYMAP_ENTRY *entry, int32_t value) {
+	int player = unit->playerOffset + entry->player;
+	uint8_t side = entry->value[1] < entry->value[0] ? STICK_SIDE_MIN : STICK_SIDE_MAX;
+	int8_t from = ctx->sticks[player].axis[entry->code].dir;
+	int8_t to;
+
+	if (stick_update(&ctx->sticks[player], entry->code, side,
+			value != entry->value[0], ctx->socd, &to) <= 0)
+		return;
+	uinput_gpad_direction(&ctx->gpads[player], entry->code, from, to,
+			ctx->source);
+}
+
+/* taps are sent on key up */
+static void actionGpadTap(TRANSLATE_CTX* const ctx, TRANSLATE_UNIT* const unit,
+		const KEYMAP_ENTRY *entry, int32_t value) {
+	if (value)
+		outputKeyTap(ctx, &ctx->gpads[unit->playerOffset + entry->player],
+				entry->code);
+}
+
+static void actionKbdKey(TRANSLATE_CTX* const ctx, TRANSLATE_UNIT* const unit,
+		const KEYMAP_ENTRY *entry, int32_t value) {
+	uinput_kbd_queue(ctx->kbd, entry->code, value, EV_KEY, ctx->source);
+}
+
+static void actionKbdTap(TRANSLATE_CTX* const ctx, TRANSLATE_UNIT* const unit,
+		const KEYMAP_ENTRY *entry, int32_t value) {
+	if (value)
+		outputKbdTap(ctx, entry->code);
+}
+
+static void releaseGpadKey(void *ctx, uint16_t evtype, uint16_t keyCode,
+		int32_t value) {
+	uinput_gpad_queue((UINP_GPAD_DEV*) ctx, keyCode, value, evtype, 0);
+}
+
+static void releaseKbdKey(void *ctx, uint16_t evtype, uint16_t keyCode,
+		int32_t value) {
+	uinput_kbd_queue((UINP_KBD_DEV*) ctx, keyCode, value, evtype, 0);
+}
+
+/* presses a button now and lets the scheduler release it, the loop keeps running meanwhile */
+static void outputKeyTap(TRANSLATE_CTX* const ctx, UINP_GPAD_DEV *gpad,
+		int keyCode) {
+	/* a release of an earlier tap still pending has to go out first */
+	if (timer_sched_cancel(ctx->sched, releaseGpadKey, gpad, keyCode)) {
+		uinput_gpad_queue(gpad, keyCode, 0, EV_KEY, 0);
+		uinput_gpad_flush(gpad);
+	}
+	uinput_gpad_queue(gpad, keyCode, 1, EV_KEY, ctx->source);
+	/* without a timer the tap ends at once, in a frame of its own */
+	if (timer_sched_add(ctx->sched, TRANSLATE_TAP_US, releaseGpadKey, gpad,
+			EV_KEY, keyCode, 0) != 0) {
+		uinput_gpad_flush(gpad);
+		uinput_gpad_queue(gpad, keyCode, 0, EV_KEY, 0);
+	}
+}
+
+static void outputKbdTap(TRANSLATE_CTX* const ctx, int keyCode) {
+	if (timer_sched_cancel(ctx->sched, releaseKbdKey, ctx->kbd, keyCode)) {
+		uinput_kbd_queue(ctx->kbd, keyCode, 0, EV_KEY, 0);
+		uinput_kbd_flush(ctx->kbd);
+	}
+	uinput_kbd_queue(ctx->kbd, keyCode, 1, EV_KEY, ctx->source);
+	if (timer_sched_add(ctx->sched, TRANSLATE_TAP_US, releaseKbdKey, ctx->kbd,
+			EV_KEY, keyCode, 0) != 0) {
+		uinput_kbd_flush(ctx->kbd);
+		uinput_kbd_queue(ctx->kbd, keyCode, 0, EV_KEY, 0);
+	}
+}
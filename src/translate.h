@@ -0,0 +1,93 @@
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 2014, Florian Mueller                      */
+/* ======================================================================== */
+
+#ifndef TRANSLATE_H_
+#define TRANSLATE_H_
+
+#include <stdint.h>
+#include <linux/input.h>
+
+#include "debounce.h"
+#include "keymap.h"
+#include "latency.h"
+#include "stick.h"
+#include "timer_sched.h"
+#include "turbo.h"
+#include "uinput_gamepad.h"
+#include "uinput_kbd.h"
+
+/* how long a tap holds its button down */
+#define TRANSLATE_TAP_US 50000
+/* chord keys held back at the same time by one stick */
+#define TRANSLATE_PENDING_MAX 8
+/* stick stamps further than this from the timer clock come from another
+ * clock, in ns */
+#define TRANSLATE_STAMP_SLACK_NS 1000000000ULL
+
+/* where translated events go, shared by all sticks */
+typedef struct {
+	const KEYMAP *keymap;
+	UINP_GPAD_DEV *gpads;
+	/* held directions, one per gamepad */
+	STICK *sticks;
+	int gpadsnum;
+	STICK_SOCD_E socd;
+	/* how long a chord key waits for the rest of its chord, in us */
+	uint32_t chord_window;
+	const DEBOUNCE_PARAMS *debounce;
+	const TURBO_PARAMS *turbo;
+	/* how late the turbo ticks ran */
+	LATENCY_HIST turbo_jitter;
+	UINP_KBD_DEV *kbd;
+	TIMER_SCHED *sched;
+	/* monotonic time of the stick event being translated, 0 outside of a batch */
+	uint64_t source;
+} TRANSLATE_CTX;
+
+/* per stick state of the translation */
+typedef struct {
+	TRANSLATE_CTX *ctx;
+	uint8_t playerOffset;
+	char keyStates[KEYMAP_LEN];
+	/* presses per key since the start, after the debounce filter */
+	uint32_t presses[KEYMAP_LEN];
+	/* chord keys pressed within the current window, not sent yet */
+	uint16_t pending[TRANSLATE_PENDING_MAX];
+	uint64_t pendingSource[TRANSLATE_PENDING_MAX];
+	uint8_t pendingnum;
+	/* bit per key whose press went into a chord, its release is dropped */
+	uint8_t consumed[KEYMAP_LEN / 8];
+	/* chords currently held down */
+	uint8_t chords[KEYMAP_CHORDS_MAX];
+	/* chatter filter in front of the keymap */
+	DEBOUNCE debounce;
+	/* turbo keys held down */
+	TURBO turbo;
+} TRANSLATE_UNIT;
+
+void translate_unit_init(TRANSLATE_UNIT* const unit, TRANSLATE_CTX* const ctx,
+		uint8_t playerOffset);
+void translate_events(TRANSLATE_CTX* const ctx, TRANSLATE_UNIT* const unit,
+		const struct input_event *ev, int count);
+void translate_queue_events(TRANSLATE_CTX* const ctx,
+		TRANSLATE_UNIT* const unit, const struct input_event *ev, int count);
+void translate_release_all(TRANSLATE_CTX* const ctx,
+		TRANSLATE_UNIT* const unit);
+void translate_flush(TRANSLATE_CTX* const ctx);
+
+#endif /* TRANSLATE_H_ */
@@ -0,0 +1,111 @@
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 2014, Florian Mueller                      */
+/* ======================================================================== */
+
+#include <string.h>
+
+#include "turbo.h"
+
+// relizations ----------------------
+void turbo_set_default(TURBO_PARAMS* const params) {
+	memset(params, 0, sizeof(*params));
+}
+
+/* gives code a turbo of rate presses per second, duty percent of each
+ * period down. A rate of 0 turns it off. */
+int16_t turbo_set(TURBO_PARAMS* const params, uint16_t code, uint32_t rate,
+		uint8_t duty) {
+	if (code >= KEY_CNT || rate > TURBO_RATE_MAX
+			|| duty < TURBO_DUTY_MIN || duty > TURBO_DUTY_MAX)
+		return -1;
+	params->period[code] = rate ? 1000000000UL / rate : 0;
+	params->on[code] = (uint64_t) params->period[code] * duty / 100;
+	return 0;
+}
+
+void turbo_reset(TURBO* const turbo) {
+	memset(turbo, 0, sizeof(*turbo));
+}
+
+/* starts the turbo of code, the button is down from now on. The first
+ * release lies on the grid and leaves it down for at least half of its
+ * on time. Returns -1 if too many turbo keys are held already. */
+int16_t turbo_press(TURBO* const turbo, const TURBO_PARAMS* const params,
+		uint16_t code, uint64_t now) {
+	uint64_t period = params->period[code];
+	uint64_t on = params->on[code];
+	uint64_t first = now + on / 2;
+	int idx = turbo->count;
+
+	if (idx == TURBO_KEYS_MAX)
+		return -1;
+	turbo->code[idx] = code;
+	turbo->down[idx] = 1;
+	turbo->next[idx] = first < on ? on
+			: (first - on + period - 1) / period * period + on;
+	turbo->count++;
+	return 0;
+}
+
+/* stops the turbo of code. Returns 1 if its button is down and needs a
+ * release, 0 if not and -1 if code has no running turbo. */
+int16_t turbo_release(TURBO* const turbo, uint16_t code) {
+	int16_t down;
+	int idx;
+
+	for (idx = 0; idx < turbo->count; idx++) {
+		if (turbo->code[idx] != code)
+			continue;
+		down = turbo->down[idx];
+		turbo->count--;
+		turbo->code[idx] = turbo->code[turbo->count];
+		turbo->next[idx] = turbo->next[turbo->count];
+		turbo->down[idx] = turbo->down[turbo->count];
+		return down;
+	}
+	return -1;
+}
+
+/* flips the button of key idx, whose edge is due, and moves on to the
+ * next edge of the grid. Edges missed by more than a period are skipped.
+ * Returns the new state of the button. */
+int16_t turbo_edge(TURBO* const turbo, const TURBO_PARAMS* const params,
+		int idx, uint64_t now) {
+	uint64_t period = params->period[turbo->code[idx]];
+	uint64_t on = params->on[turbo->code[idx]];
+
+	if (turbo->down[idx])
+		turbo->next[idx] += period - on;
+	else
+		turbo->next[idx] += on;
+	turbo->down[idx] = !turbo->down[idx];
+	if (turbo->next[idx] <= now)
+		turbo->next[idx] += ((now - turbo->next[idx]) / period + 1) * period;
+	return turbo->down[idx];
+}
+
+/* the earliest edge of all keys, 0 if no turbo is running */
+uint64_t turbo_due(const TURBO* const turbo) {
+	uint64_t due = 0;
+	int idx;
+
+	for (idx = 0; idx < turbo->count; idx++) {
+		if (due == 0 || turbo->next[idx] < due)
+			due = turbo->next[idx];
+	}
+	return due;
+}
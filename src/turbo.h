@@ -0,0 +1,66 @@
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 2014, Florian Mueller                      */
+/* ======================================================================== */
+
+#ifndef TURBO_H_
+#define TURBO_H_
+
+#include <stdint.h>
+#include <linux/input.h>
+
+/* turbo keys held down at the same time on one stick */
+#define TURBO_KEYS_MAX 16
+/* share of every period the button is down unless configured otherwise,
+ * and the range it may be configured in, in percent */
+#define TURBO_DUTY_DEFAULT 50
+#define TURBO_DUTY_MIN 10
+#define TURBO_DUTY_MAX 90
+/* presses per second */
+#define TURBO_RATE_MAX 60
+
+typedef struct {
+	/* per key code in ns, 0 if the key has no turbo */
+	uint32_t period[KEY_CNT];
+	/* how long the button is down in every period, in ns */
+	uint32_t on[KEY_CNT];
+} TURBO_PARAMS;
+
+/* per stick state. Edges lie on a grid of multiples of the period on the
+ * monotonic clock, so keys with the same rate toggle at the same time. */
+typedef struct {
+	uint16_t code[TURBO_KEYS_MAX];
+	/* monotonic time of the next edge in ns */
+	uint64_t next[TURBO_KEYS_MAX];
+	/* 1 while the button is down on the virtual device */
+	uint8_t down[TURBO_KEYS_MAX];
+	uint8_t count;
+	/* when the next tick was scheduled for, 0 if none is */
+	uint64_t armed;
+} TURBO;
+
+void turbo_set_default(TURBO_PARAMS* const params);
+int16_t turbo_set(TURBO_PARAMS* const params, uint16_t code, uint32_t rate,
+		uint8_t duty);
+void turbo_reset(TURBO* const turbo);
+int16_t turbo_press(TURBO* const turbo, const TURBO_PARAMS* const params,
+		uint16_t code, uint64_t now);
+int16_t turbo_release(TURBO* const turbo, uint16_t code);
+int16_t turbo_edge(TURBO* const turbo, const TURBO_PARAMS* const params,
+		int idx, uint64_t now);
+uint64_t turbo_due(const TURBO* const turbo);
+
+#endif /* TURBO_H_ */
@@ -0,0 +1,82 @@
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 2014, Florian Mueller                      */
+/* ======================================================================== */
+
+#include <stdio.h>
+
+#include "uinput_batch.h"
+
+/* queues an event, the batch is flushed first if it has run full */
+int16_t uinput_batch_add(UINP_BATCH* const batch, OUTPUT_DEV* const out,
+		uint16_t evtype, uint16_t keycode, int32_t keyvalue, uint64_t source) {
+	struct input_event *event;
+
+	if (batch->count == UINPUT_BATCH_LEN)
+		uinput_batch_flush(batch, out);
+
+	batch->source[batch->count] = source;
+	event = &batch->ev[batch->count++];
+	event->type = evtype;
+	event->code = keycode;
+	event->value = keyvalue;
+	return 0;
+}
+
+/* emits all queued events terminated by a single SYN_REPORT at once. The
+ * clock is read once per batch, all events of the frame share one time.
+ * The latency histogram reads it again after the write so the time spent
+ * in the kernel is part of the measurement. */
+int16_t uinput_batch_flush(UINP_BATCH* const batch, OUTPUT_DEV* const out) {
+	struct input_event *syn = &batch->ev[batch->count];
+	uint16_t count = batch->count;
+	uint64_t now, stamp = 0;
+	uint16_t ctr;
+
+	if (batch->count == 0)
+		return 0;
+
+	now = latency_now();
+	if (batch->stamp == UINPUT_BATCH_STAMP_SOURCE) {
+		/* the newest stick event completes the frame */
+		for (ctr = 0; ctr < count; ctr++) {
+			if (batch->source[ctr] <= now && batch->source[ctr] > stamp)
+				stamp = batch->source[ctr];
+		}
+	}
+	if (stamp == 0)
+		stamp = now;
+	syn->time.tv_sec = stamp / 1000000000ULL;
+	syn->time.tv_usec = stamp % 1000000000ULL / 1000;
+	syn->type = EV_SYN;
+	syn->code = SYN_REPORT;
+	syn->value = 0;
+	for (ctr = 0; ctr < batch->count; ctr++)
+		batch->ev[ctr].time = syn->time;
+	batch->count = 0;
+
+	if (output_emit(out, batch->ev, count + 1) != 0)
+		return -1;
+
+	batch->sent += count + 1;
+	now = latency_now();
+	for (ctr = 0; ctr < count; ctr++) {
+		/* sources stamped with another clock would give nonsense */
+		if (batch->source[ctr] != 0 && batch->source[ctr] <= now)
+			latency_record(&batch->latency, now - batch->source[ctr]);
+	}
+	return 0;
+}
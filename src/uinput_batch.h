@@ -0,0 +1,57 @@
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 2014, Florian Mueller                      */
+/* ======================================================================== */
+
+#ifndef UINPUT_BATCH_H_
+#define UINPUT_BATCH_H_
+
+#include <stdint.h>
+#include <linux/input.h>
+
+#include "latency.h"
+#include "output.h"
+
+/* maximum number of events collected for one device between two flushes */
+#define UINPUT_BATCH_LEN 64
+
+/* the time written events carry. Older kernels ignore it on uinput and stamp
+ * events on arrival, recent ones keep a monotonic time that is neither in the
+ * future nor more than 10 s old. The file and memory outputs always keep it. */
+typedef enum {
+	UINPUT_BATCH_STAMP_NOW = 0,	// when the batch is flushed
+	UINPUT_BATCH_STAMP_SOURCE = 1	// kernel time of the stick event behind it
+} UINPUT_BATCH_STAMP_E;
+
+typedef struct {
+	uint16_t count;
+	/* UINPUT_BATCH_STAMP_E */
+	uint8_t stamp;
+	/* one more slot for the closing SYN_REPORT */
+	struct input_event ev[UINPUT_BATCH_LEN + 1];
+	/* monotonic time of the stick event behind ev[], 0 for generated ones */
+	uint64_t source[UINPUT_BATCH_LEN];
+	/* from source event to the write into the device */
+	LATENCY_HIST latency;
+	/* events written, SYN_REPORTs included */
+	uint64_t sent;
+} UINP_BATCH;
+
+int16_t uinput_batch_add(UINP_BATCH* const batch, OUTPUT_DEV* const out,
+		uint16_t evtype, uint16_t keycode, int32_t keyvalue, uint64_t source);
+int16_t uinput_batch_flush(UINP_BATCH* const batch, OUTPUT_DEV* const out);
+
+#endif /* UINPUT_BATCH_H_ */
@@ -17,123 +17,113 @@
 /* ======================================================================== */
 
 #include <linux/input.h>
-#include <linux/uinput.h>
-#include <fcntl.h>
 #include <stdio.h>
-#include <string.h>
-#include <unistd.h>
 
 #include "uinput_gamepad.h"
 
-/* sends a key event to the virtual device */
-static void send_key_event(int fd, unsigned int keycode, int keyvalue,
-		unsigned int evtype) {
-	struct input_event event;
-	gettimeofday(&event.time, NULL);
+/* Setup the virtual gamepad on the given output backend. It gets the
+ * buttons and axes in targets, ABS_X and ABS_Y in the form dirs asks for. */
+int16_t uinput_gpad_open(UINP_GPAD_DEV* const gpad,
+		const OUTPUT_BACKEND *backend, const char *arg,
+		UINPUT_GPAD_DIRS_E dirs, unsigned char number,
+		const KEYMAP_TARGETS* const targets) {
+	OUTPUT_SPEC spec;
+	char name[80];
+	int code;
 
-	event.type = evtype;
-	event.code = keycode;
-	event.value = keyvalue;
+	snprintf(name, sizeof(name), "Xarcade-to-Gamepad Device %i", number);
+	output_spec_init(&spec, name);
 
-	if (write(fd, &event, sizeof(event)) < 0) {
-		printf("[uinput_gamepad] Simulate key error\n");
+	// gamepad, buttons
+	for (code = 0; code < KEY_CNT; code++) {
+		if (KEYMAP_TARGET_TEST(targets->keybits, code))
+			output_spec_key(&spec, code);
 	}
 
-	event.type = EV_SYN;
-	event.code = SYN_REPORT;
-	event.value = 0;
-	write(fd, &event, sizeof(event));
-	if (write(fd, &event, sizeof(event)) < 0) {
-		printf("[uinput_gamepad] Simulate key error\n");
+	// gamepad, directions of the stick as far as the mapping sends them
+	if (dirs == UINPUT_GPAD_DIRS_HAT) {
+		if (KEYMAP_TARGET_TEST(targets->absbits, ABS_X))
+			output_spec_abs(&spec, ABS_HAT0X, -1, 1);
+		if (KEYMAP_TARGET_TEST(targets->absbits, ABS_Y))
+			output_spec_abs(&spec, ABS_HAT0Y, -1, 1);
+	} else if (dirs == UINPUT_GPAD_DIRS_DPAD) {
+		if (KEYMAP_TARGET_TEST(targets->absbits, ABS_X)) {
+			output_spec_key(&spec, BTN_DPAD_LEFT);
+			output_spec_key(&spec, BTN_DPAD_RIGHT);
+		}
+		if (KEYMAP_TARGET_TEST(targets->absbits, ABS_Y)) {
+			output_spec_key(&spec, BTN_DPAD_UP);
+			output_spec_key(&spec, BTN_DPAD_DOWN);
+		}
 	}
-}
 
-/* Setup the uinput device */
-int16_t uinput_gpad_open(UINP_GPAD_DEV* const gpad, UINPUT_GPAD_TYPE_E type,
-			 unsigned char number) {
-	int16_t uinp_fd = -1;
-	gpad->fd = open("/dev/uinput", O_WRONLY | O_NDELAY);
-	if (gpad->fd <= 0) {
-		printf("Unable to open /dev/uinput (running as root may help)\n");
-		return -1;
+	// gamepad, axes. Other axes stay axes whatever dirs says
+	for (code = 0; code < ABS_CNT; code++) {
+		if ((dirs == UINPUT_GPAD_DIRS_AXIS || (code != ABS_X && code != ABS_Y))
+				&& KEYMAP_TARGET_TEST(targets->absbits, code))
+			output_spec_abs(&spec, code, UINPUT_GPAD_AXIS_MIN, UINPUT_GPAD_AXIS_MAX);
 	}
 
-	struct uinput_user_dev uinp;
-	memset(&uinp, 0, sizeof(uinp));
-	snprintf(uinp.name, sizeof(uinp.name), "Xarcade-to-Gamepad Device %i", number);
-	uinp.id.version = 4;
-	uinp.id.bustype = BUS_USB;
-	uinp.id.product = 1;
-	uinp.id.vendor = 1;
-
-	// Setup the uinput device
-	ioctl(gpad->fd, UI_SET_EVBIT, EV_KEY);
-	ioctl(gpad->fd, UI_SET_EVBIT, EV_REL);
-
-	// gamepad, buttons
-	ioctl(gpad->fd, UI_SET_KEYBIT, BTN_A);
-	ioctl(gpad->fd, UI_SET_KEYBIT, BTN_B);
-	ioctl(gpad->fd, UI_SET_KEYBIT, BTN_C);
-	ioctl(gpad->fd, UI_SET_KEYBIT, BTN_X);
-	ioctl(gpad->fd, UI_SET_KEYBIT, BTN_Y);
-	ioctl(gpad->fd, UI_SET_KEYBIT, BTN_Z);
-	ioctl(gpad->fd, UI_SET_KEYBIT, BTN_TL);
-	ioctl(gpad->fd, UI_SET_KEYBIT, BTN_TR);
-	ioctl(gpad->fd, UI_SET_KEYBIT, BTN_SELECT);
-	ioctl(gpad->fd, UI_SET_KEYBIT, BTN_START);
-
-	// gamepad, directions
-	ioctl(gpad->fd, UI_SET_EVBIT, EV_ABS);
-	ioctl(gpad->fd, UI_SET_ABSBIT, ABS_X);
-	ioctl(gpad->fd, UI_SET_ABSBIT, ABS_Y);
-	uinp.absmin[ABS_X] = 0;
-	uinp.absmax[ABS_X] = 4;
-	uinp.absmin[ABS_Y] = 0;
-	uinp.absmax[ABS_Y] = 4;
-
-	/* Create input device into input sub-system */
-	write(gpad->fd, &uinp, sizeof(uinp));
-	if (ioctl(gpad->fd, UI_DEV_CREATE)) {
-		printf("[uinput_gamepad] Unable to create UINPUT device.");
+	if (output_create(&gpad->out, backend, arg, &spec) != 0) {
+		printf("[uinput_gamepad] Unable to create %s device.\n", backend->name);
 		return -1;
 	}
 
-	send_key_event(gpad->fd, ABS_X, 2, EV_ABS);
-	send_key_event(gpad->fd, ABS_Y, 2, EV_ABS);
+	gpad->dirs = dirs;
+	gpad->batch.count = 0;
+	gpad->batch.stamp = UINPUT_BATCH_STAMP_NOW;
+	for (code = 0; code < ABS_CNT; code++) {
+		if (OUTPUT_BIT_TEST(spec.absbits, code)
+				&& spec.absinfo[code].maximum == UINPUT_GPAD_AXIS_MAX)
+			uinput_gpad_queue(gpad, code, UINPUT_GPAD_AXIS_CENTER, EV_ABS, 0);
+	}
+	uinput_gpad_flush(gpad);
 
-	return uinp_fd;
+	return 0;
 }
 
 int16_t uinput_gpad_close(UINP_GPAD_DEV* const gpad) {
-	ioctl(gpad->fd, UI_DEV_DESTROY);
-	return close(gpad->fd);
+	return output_destroy(&gpad->out);
 }
 
-/* sends a key event to the virtual device */
-int16_t uinput_gpad_write(UINP_GPAD_DEV* const gpad, uint16_t keycode,
-		int16_t keyvalue, uint16_t evtype) {
-	struct input_event event;
-	gettimeofday(&event.time, NULL);
-
-	event.type = evtype;
-	event.code = keycode;
-	event.value = keyvalue;
-
-	if (write(gpad->fd, &event, sizeof(event)) < 0) {
-		printf("[uinput_gamepad] Simulate key error\n");
-	}
+/* queues a key event, it is sent with the next flush */
+int16_t uinput_gpad_queue(UINP_GPAD_DEV* const gpad, uint16_t keycode,
+		int16_t keyvalue, uint16_t evtype, uint64_t source) {
+	return uinput_batch_add(&gpad->batch, &gpad->out, evtype, keycode, keyvalue,
+			source);
+}
 
-	event.type = EV_SYN;
-	event.code = SYN_REPORT;
-	event.value = 0;
-	if (write(gpad->fd, &event, sizeof(event)) < 0) {
-		printf("[uinput_gamepad] Simulate key error\n");
-	}
-	return 0;
+/* queues the move of a stick axis from one direction (-1, 0, 1) to another.
+ * ABS_X and ABS_Y become hat or dpad events if the gamepad uses them,
+ * every other axis stays an axis. */
+int16_t uinput_gpad_direction(UINP_GPAD_DEV* const gpad, uint16_t axis,
+		int8_t from, int8_t to, uint64_t source) {
+	static const uint16_t dpad[2][2] = {
+		{ BTN_DPAD_LEFT, BTN_DPAD_RIGHT },
+		{ BTN_DPAD_UP, BTN_DPAD_DOWN },
+	};
+	int16_t result = 0;
+
+	if (from == to)
+		return 0;
+	if (gpad->dirs == UINPUT_GPAD_DIRS_AXIS || (axis != ABS_X && axis != ABS_Y))
+		return uinput_gpad_queue(gpad, axis,
+				UINPUT_GPAD_AXIS_CENTER + to * (UINPUT_GPAD_AXIS_MAX - UINPUT_GPAD_AXIS_CENTER),
+				EV_ABS, source);
+	if (gpad->dirs == UINPUT_GPAD_DIRS_HAT)
+		return uinput_gpad_queue(gpad, axis == ABS_X ? ABS_HAT0X : ABS_HAT0Y, to,
+				EV_ABS, source);
+
+	if (from != 0)
+		result = uinput_gpad_queue(gpad, dpad[axis == ABS_Y][from > 0], 0,
+				EV_KEY, source);
+	if (to != 0)
+		result |= uinput_gpad_queue(gpad, dpad[axis == ABS_Y][to > 0], 1,
+				EV_KEY, source);
+	return result;
 }
 
-/* sleep between immediate successive gpad writes */
-int16_t uinput_gpad_sleep() {
-	usleep(50000);
-	return 0;
+/* sends all queued events as one frame */
+int16_t uinput_gpad_flush(UINP_GPAD_DEV* const gpad) {
+	return uinput_batch_flush(&gpad->batch, &gpad->out);
 }
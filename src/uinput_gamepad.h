@@ -21,22 +21,36 @@
 
 #include <stdint.h>
 
+#include "keymap.h"
+#include "uinput_batch.h"
+
+/* how the directions of the digital stick show up on the gamepad */
 typedef enum {
-	UINPUT_GPAD_TYPE_NES = 0,
-	UINPUT_GPAD_TYPE_SNES = 1,
-	UINPUT_GPAD_TYPE_XARCADE = 2
-} UINPUT_GPAD_TYPE_E;
+	UINPUT_GPAD_DIRS_AXIS = 0,	// ABS_X/ABS_Y, 0..4 with center 2
+	UINPUT_GPAD_DIRS_HAT = 1,	// ABS_HAT0X/ABS_HAT0Y, -1..1
+	UINPUT_GPAD_DIRS_DPAD = 2	// BTN_DPAD_UP/DOWN/LEFT/RIGHT
+} UINPUT_GPAD_DIRS_E;
+
+#define UINPUT_GPAD_AXIS_MIN 0
+#define UINPUT_GPAD_AXIS_CENTER 2
+#define UINPUT_GPAD_AXIS_MAX 4
 
 typedef struct {
-	int fd;
+	OUTPUT_DEV out;
 	int16_t state;
+	uint8_t dirs;
+	UINP_BATCH batch;
 } UINP_GPAD_DEV;
 
-int16_t uinput_gpad_open(UINP_GPAD_DEV* const gpad, UINPUT_GPAD_TYPE_E type,
-			 unsigned char number);
+int16_t uinput_gpad_open(UINP_GPAD_DEV* const gpad,
+		const OUTPUT_BACKEND *backend, const char *arg,
+		UINPUT_GPAD_DIRS_E dirs, unsigned char number,
+		const KEYMAP_TARGETS* const targets);
 int16_t uinput_gpad_close(UINP_GPAD_DEV* const gpad);
-int16_t uinput_gpad_write(UINP_GPAD_DEV* const gpad, uint16_t keycode,
-		int16_t keyvalue, uint16_t evtype);
-int16_t uinput_gpad_sleep();
+int16_t uinput_gpad_queue(UINP_GPAD_DEV* const gpad, uint16_t keycode,
+		int16_t keyvalue, uint16_t evtype, uint64_t source);
+int16_t uinput_gpad_direction(UINP_GPAD_DEV* const gpad, uint16_t axis,
+		int8_t from, int8_t to, uint64_t source);
+int16_t uinput_gpad_flush(UINP_GPAD_DEV* const gpad);
 
 #endif /* UINPUT_GAMEPAD_H_ */
@@ -17,81 +17,47 @@
 /* ======================================================================== */
 
 #include <linux/input.h>
-#include <linux/uinput.h>
-#include <fcntl.h>
 #include <stdio.h>
-#include <string.h>
-#include <unistd.h>
 
 #include "uinput_kbd.h"
 
-/* Setup the uinput keyboard device */
-int16_t uinput_kbd_open(UINP_KBD_DEV* const kbd) {
-	kbd->fd = open("/dev/uinput", O_WRONLY | O_NDELAY);
-	if (kbd->fd == 0) {
-		printf("Unable to open /dev/uinput (running as root may help)\n");
-		return -1;
-	}
+/* Setup the virtual keyboard on the given output backend, with the keys
+ * in targets */
+int16_t uinput_kbd_open(UINP_KBD_DEV* const kbd, const OUTPUT_BACKEND *backend,
+		const char *arg, const KEYMAP_TARGETS* const targets) {
+	OUTPUT_SPEC spec;
+	int i = 0;
 
-	struct uinput_user_dev uinp;
-	memset(&uinp, 0, sizeof(uinp));
-	strncpy(uinp.name, "SNES-to-Keyboard Device",
-			strlen("SNES-to-Keyboard Device"));
-	uinp.id.version = 4;
-	uinp.id.bustype = BUS_USB;
-	uinp.id.product = 1;
-	uinp.id.vendor = 1;
+	output_spec_init(&spec, "SNES-to-Keyboard Device");
 
-	// Setup the uinput device
 	// keyboard
-	ioctl(kbd->fd, UI_SET_EVBIT, EV_KEY);
-	ioctl(kbd->fd, UI_SET_EVBIT, EV_REL);
-	int i = 0;
-	for (i = 0; i < 256; i++) {
-		ioctl(kbd->fd, UI_SET_KEYBIT, i);
+	for (i = 0; i < KEY_CNT; i++) {
+		if (KEYMAP_TARGET_TEST(targets->keybits, i))
+			output_spec_key(&spec, i);
 	}
 
-	/* Create input device into input sub-system */
-	write(kbd->fd, &uinp, sizeof(uinp));
-	if (ioctl(kbd->fd, UI_DEV_CREATE)) {
-		printf("[xarcade2jstick] Unable to create UINPUT device.");
+	if (output_create(&kbd->out, backend, arg, &spec) != 0) {
+		printf("[uinput_kbd] Unable to create %s device.\n", backend->name);
 		return -1;
 	}
+	kbd->batch.count = 0;
+	kbd->batch.stamp = UINPUT_BATCH_STAMP_NOW;
 
-	return kbd->fd;
+	return 0;
 }
 
 int16_t uinput_kbd_close(UINP_KBD_DEV* const kbd) {
-	ioctl(kbd->fd, UI_DEV_DESTROY);
-	return close(kbd->fd);
+	return output_destroy(&kbd->out);
 }
 
-/* sends a key event to the virtual device */
-int16_t uinput_kbd_write(UINP_KBD_DEV* const kbd, unsigned int keycode,
-		int keyvalue, unsigned int evtype) {
-	struct input_event event;
-	gettimeofday(&event.time, NULL);
-
-	event.type = evtype;
-	event.code = keycode;
-	event.value = keyvalue;
-
-	if (write(kbd->fd, &event, sizeof(event)) < 0) {
-		printf("[SNESDev-Rpi] Simulate key error\n");
-	}
-
-	event.type = EV_SYN;
-	event.code = SYN_REPORT;
-	event.value = 0;
-	write(kbd->fd, &event, sizeof(event));
-	if (write(kbd->fd, &event, sizeof(event)) < 0) {
-		printf("[xarcade2jstick] Simulate key error\n");
-	}
-	return 0;
+/* queues a key event, it is sent with the next flush */
+int16_t uinput_kbd_queue(UINP_KBD_DEV* const kbd, unsigned int keycode,
+		int keyvalue, unsigned int evtype, uint64_t source) {
+	return uinput_batch_add(&kbd->batch, &kbd->out, evtype, keycode, keyvalue,
+			source);
 }
 
-/* sleep between immediate successive keyboard writes */
-int16_t uinput_kbd_sleep() {
-	usleep(50000);
-	return 0;
+/* sends all queued events as one frame */
+int16_t uinput_kbd_flush(UINP_KBD_DEV* const kbd) {
+	return uinput_batch_flush(&kbd->batch, &kbd->out);
 }
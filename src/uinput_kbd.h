@@ -21,14 +21,19 @@
 
 #include <stdint.h>
 
+#include "keymap.h"
+#include "uinput_batch.h"
+
 typedef struct {
-	int16_t fd;
+	OUTPUT_DEV out;
+	UINP_BATCH batch;
 } UINP_KBD_DEV;
 
-int16_t uinput_kbd_open(UINP_KBD_DEV* const kbd);
+int16_t uinput_kbd_open(UINP_KBD_DEV* const kbd, const OUTPUT_BACKEND *backend,
+		const char *arg, const KEYMAP_TARGETS* const targets);
 int16_t uinput_kbd_close(UINP_KBD_DEV* const kbd);
-int16_t uinput_kbd_write(UINP_KBD_DEV* const kbd, unsigned int keycode,
-		int keyvalue, unsigned int evtype);
-int16_t uinput_kbd_sleep();
+int16_t uinput_kbd_queue(UINP_KBD_DEV* const kbd, unsigned int keycode,
+		int keyvalue, unsigned int evtype, uint64_t source);
+int16_t uinput_kbd_flush(UINP_KBD_DEV* const kbd);
 
 #endif /* UINPUT_KBD_H_ */
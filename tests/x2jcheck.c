@@ -0,0 +1,534 @@
+/* ======================================================================== */
+/*  This program is free software; you can redistribute it and/or modify    */
+/*  it under the terms of the GNU General Public License as published by    */
+/*  the Free Software Foundation; either version 2 of the License, or       */
+/*  (at your option) any later version.                                     */
+/*                                                                          */
+/*  This program is distributed in the hope that it will be useful,         */
+/*  but WITHOUT ANY WARRANTY; without even the implied warranty of          */
+/*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU       */
+/*  General Public License for more details.                                */
+/*                                                                          */
+/*  You should have received a copy of the GNU General Public License       */
+/*  along with this program; if not, write to the Free Software             */
+/*  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.               */
+/* ======================================================================== */
+/*                 Copyright (c) 2014, Florian Mueller                      */
+/* ======================================================================== */
+
+/* Replay checks: feeds short recordings through the translation into the
+ * file output and compares what the virtual devices sent with what they
+ * should have sent. Needs neither a stick nor uinput, run by "make check".
+ * Every case runs twice, once like the main loop and once with --threads.
+ * A recording replayed with --loops 2 has to come out twice the same,
+ * a read longer than a slot of --threads as one frame.
+ * The stick side of a SYN_DROPPED is checked on its own, through a pipe. */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/input.h>
+
+#include "config.h"
+#include "input_xarcade.h"
+#include "output.h"
+#include "replay.h"
+#include "trace.h"
+
+/* recordings start here, in ns of the stick clock */
+#define CHECK_START 1000000000ULL
+#define CHECK_RESULT_LEN 1024
+
+/* a key of the stick, gap is the time since the previous one in ms */
+typedef struct {
+	uint16_t code;
+	int32_t value;
+	uint32_t gap;
+} CHECK_KEY;
+
+/* expected is one "unit: type,code,value ..." per frame, SYN_REPORTs left
+ * out and frames separated by " | " */
+typedef struct {
+	const char *name;
+	const char *config;
+	const CHECK_KEY *keys;
+	int count;
+	const char *expected;
+} CHECK_CASE;
+
+#define CHECK_KEYS(keys) keys, sizeof(keys) / sizeof(keys[0])
+
+/* both gamepads of the built-in layout center their axes when created */
+#define CHECK_INIT "0: 3,0,2 3,1,2 | 1: 3,0,2 3,1,2"
+
+/* player 1 button A and left, player 2 button A */
+static const CHECK_KEY keymapKeys[] = {
+	{ KEY_LEFTCTRL, 1, 8 }, { KEY_LEFTCTRL, 0, 8 },
+	{ KEY_LEFT, 1, 8 }, { KEY_LEFT, 0, 8 },
+	{ KEY_A, 1, 8 }, { KEY_A, 0, 8 }
+};
+
+/* left, right on top of it, right released, left released */
+static const CHECK_KEY socdKeys[] = {
+	{ KEY_LEFT, 1, 8 }, { KEY_RIGHT, 1, 8 },
+	{ KEY_RIGHT, 0, 8 }, { KEY_LEFT, 0, 8 }
+};
+
+/* the built-in KEY_4+KEY_2 chord, then KEY_4 alone long enough to count */
+static const CHECK_KEY chordKeys[] = {
+	{ KEY_4, 1, 8 }, { KEY_2, 1, 5 }, { KEY_2, 0, 50 }, { KEY_4, 0, 8 },
+	{ KEY_4, 1, 100 }, { KEY_4, 0, 50 }
+};
+
+/* bounces of 1 ms on the press, then a clean release */
+static const CHECK_KEY eagerKeys[] = {
+	{ KEY_LEFTCTRL, 1, 8 }, { KEY_LEFTCTRL, 0, 1 },
+	{ KEY_LEFTCTRL, 1, 1 }, { KEY_LEFTCTRL, 0, 20 }
+};
+
+/* a 2 ms spike, then a real press */
+static const CHECK_KEY deferredKeys[] = {
+	{ KEY_LEFTCTRL, 1, 8 }, { KEY_LEFTCTRL, 0, 2 },
+	{ KEY_LEFTCTRL, 1, 50 }, { KEY_LEFTCTRL, 0, 50 }
+};
+
+/* left, right ignored, left released hands over to right */
+static const CHECK_KEY socdFirstKeys[] = {
+	{ KEY_LEFT, 1, 8 }, { KEY_RIGHT, 1, 8 },
+	{ KEY_LEFT, 0, 8 }, { KEY_RIGHT, 0, 8 }
+};
+
+/* left and up of player 1 overlapping */
+static const CHECK_KEY directionKeys[] = {
+	{ KEY_LEFT, 1, 8 }, { KEY_UP, 1, 8 },
+	{ KEY_LEFT, 0, 8 }, { KEY_UP, 0, 8 }
+};
+
+/* a key without mapping, then player 1 button A */
+static const CHECK_KEY passthroughKeys[] = {
+	{ KEY_F1, 1, 8 }, { KEY_F1, 0, 8 },
+	{ KEY_LEFTCTRL, 1, 8 }, { KEY_LEFTCTRL, 0, 8 }
+};
+
+/* held for 120 ms at 20 presses per second */
+static const CHECK_KEY turboKeys[] = {
+	{ KEY_LEFTCTRL, 1, 8 }, { KEY_LEFTCTRL, 0, 120 }
+};
+
+/* a bouncing turbo press, then player 2 button A and the first key of the
+ * built-in chord held at the end */
+static const CHECK_KEY loopKeys[] = {
+	{ KEY_LEFTCTRL, 1, 8 }, { KEY_LEFTCTRL, 0, 1 }, { KEY_LEFTCTRL, 1, 1 },
+	{ KEY_LEFTCTRL, 0, 120 }, { KEY_A, 1, 8 }, { KEY_4, 1, 8 }
+};
+#define CHECK_LOOP_CONFIG "debounce eager 5\nturbo KEY_LEFTCTRL 20\n"
+
+static const CHECK_CASE checkCases[] = {
+	{ "keymap", "", CHECK_KEYS(keymapKeys),
+		CHECK_INIT " | 0: 1,304,1 | 0: 1,304,0 | 0: 3,0,0 | 0: 3,0,2"
+		" | 1: 1,304,1 | 1: 1,304,0" },
+	{ "socd last", "socd last\n", CHECK_KEYS(socdKeys),
+		CHECK_INIT " | 0: 3,0,0 | 0: 3,0,4 | 0: 3,0,0 | 0: 3,0,2" },
+	{ "socd neutral", "socd neutral\n", CHECK_KEYS(socdKeys),
+		CHECK_INIT " | 0: 3,0,0 | 0: 3,0,2 | 0: 3,0,0 | 0: 3,0,2" },
+	{ "socd first", "socd first\n", CHECK_KEYS(socdFirstKeys),
+		CHECK_INIT " | 0: 3,0,0 | 0: 3,0,4 | 0: 3,0,2" },
+	/* a hat or dpad starts out centered, only player 2 sends its axes */
+	{ "directions hat", "directions 1 hat\n", CHECK_KEYS(directionKeys),
+		"1: 3,0,2 3,1,2 | 0: 3,16,-1 | 0: 3,17,-1 | 0: 3,16,0 | 0: 3,17,0" },
+	{ "directions dpad", "directions 1 dpad\n", CHECK_KEYS(directionKeys),
+		"1: 3,0,2 3,1,2 | 0: 1,546,1 | 0: 1,544,1 | 0: 1,546,0 | 0: 1,544,0" },
+	{ "passthrough", "passthrough unmapped\n", CHECK_KEYS(passthroughKeys),
+		CHECK_INIT " | 2: 1,59,1 | 2: 1,59,0 | 0: 1,304,1 | 0: 1,304,0" },
+	{ "chord", "", CHECK_KEYS(chordKeys),
+		CHECK_INIT " | 2: 1,15,1 | 2: 1,15,0 | 1: 1,314,1 | 1: 1,314,0" },
+	{ "debounce eager", "debounce eager 5\n", CHECK_KEYS(eagerKeys),
+		CHECK_INIT " | 0: 1,304,1 | 0: 1,304,0" },
+	{ "debounce deferred", "debounce deferred 5\n", CHECK_KEYS(deferredKeys),
+		CHECK_INIT " | 0: 1,304,1 | 0: 1,304,0" },
+	{ "turbo", "turbo KEY_LEFTCTRL 20\n", CHECK_KEYS(turboKeys),
+		CHECK_INIT " | 0: 1,304,1 | 0: 1,304,0 | 0: 1,304,1 | 0: 1,304,0"
+		" | 0: 1,304,1 | 0: 1,304,0" }
+};
+#define CHECK_CASES (sizeof(checkCases) / sizeof(checkCases[0]))
+
+static char checkDir[] = "/tmp/x2jcheck.XXXXXX";
+
+// declaration of supplementary functions  -------------------
+static int16_t runCase(const CHECK_CASE* const check, uint8_t threaded);
+static int16_t writeConfig(const char *path, const char *text);
+static int16_t writeRecording(const char *path, const CHECK_KEY *keys,
+		int count);
+static int16_t readResult(const char *path, char *result, size_t len);
+static int16_t replayQuiet(const char *path, const CONFIG* const config,
+		uint32_t loops, uint8_t threaded, const char *out);
+static size_t renderEvents(const struct input_event *ev, int count,
+		char *buf, size_t len);
+static int16_t checkLoops(uint8_t threaded);
+static int16_t checkLongRead(uint8_t threaded);
+static int16_t checkMemory();
+static int16_t checkDropped();
+
+int main(int argc, char *argv[]) {
+	char path[64];
+	int failed = 0;
+	unsigned int ctr;
+
+	if (mkdtemp(checkDir) == NULL) {
+		printf("[x2jcheck] Unable to create %s: %s\n", checkDir, strerror(errno));
+		return 1;
+	}
+	for (ctr = 0; ctr < CHECK_CASES; ctr++) {
+		if (runCase(&checkCases[ctr], 0) != 0)
+			failed++;
+		if (runCase(&checkCases[ctr], 1) != 0)
+			failed++;
+	}
+	if (checkLoops(0) != 0)
+		failed++;
+	if (checkLoops(1) != 0)
+		failed++;
+	if (checkLongRead(0) != 0)
+		failed++;
+	if (checkLongRead(1) != 0)
+		failed++;
+	if (checkMemory() != 0)
+		failed++;
+	if (checkDropped() != 0)
+		failed++;
+
+	snprintf(path, sizeof(path), "%s/in.trace", checkDir);
+	unlink(path);
+	snprintf(path, sizeof(path), "%s/out.trace", checkDir);
+	unlink(path);
+	snprintf(path, sizeof(path), "%s/test.conf", checkDir);
+	unlink(path);
+	rmdir(checkDir);
+
+	if (failed) {
+		printf("[x2jcheck] %d check(s) failed\n", failed);
+		return 1;
+	}
+	printf("[x2jcheck] All %u checks passed\n", (unsigned int) CHECK_CASES * 2 + 6);
+	return 0;
+}
+
+// supplementary functions -------------------
+
+static int16_t runCase(const CHECK_CASE* const check, uint8_t threaded) {
+	char conf[64], in[64], out[64], result[CHECK_RESULT_LEN];
+	CONFIG config;
+
+	snprintf(conf, sizeof(conf), "%s/test.conf", checkDir);
+	snprintf(in, sizeof(in), "%s/in.trace", checkDir);
+	snprintf(out, sizeof(out), "%s/out.trace", checkDir);
+
+	config_set_default(&config);
+	if (writeConfig(conf, check->config) != 0
+			|| config_load(&config, conf) != 0
+			|| writeRecording(in, check->keys, check->count) != 0
+			|| replayQuiet(in, &config, 1, threaded, out) != 0
+			|| readResult(out, result, sizeof(result)) != 0) {
+		printf("FAIL %s%s: unable to run the replay\n", check->name,
+				threaded ? " (threads)" : "");
+		return -1;
+	}
+	if (strcmp(result, check->expected) != 0) {
+		printf("FAIL %s%s\n  expected %s\n  got      %s\n", check->name,
+				threaded ? " (threads)" : "", check->expected, result);
+		return -1;
+	}
+	printf("PASS %s%s\n", check->name, threaded ? " (threads)" : "");
+	return 0;
+}
+
+static int16_t writeConfig(const char *path, const char *text) {
+	FILE *file = fopen(path, "w");
+
+	if (file == NULL)
+		return -1;
+	fputs(text, file);
+	return fclose(file) == 0 ? 0 : -1;
+}
+
+/* one batch per key, closed by a SYN_REPORT like the stick sends it */
+static int16_t writeRecording(const char *path, const CHECK_KEY *keys,
+		int count) {
+	struct input_event ev[2];
+	uint64_t time = CHECK_START;
+	TRACE trace = { .fd = -1 };
+	int ctr;
+
+	if (trace_create(&trace, path) != 0)
+		return -1;
+	memset(ev, 0, sizeof(ev));
+	for (ctr = 0; ctr < count; ctr++) {
+		time += keys[ctr].gap * 1000000ULL;
+		ev[0].time.tv_sec = ev[1].time.tv_sec = time / 1000000000ULL;
+		ev[0].time.tv_usec = ev[1].time.tv_usec = time % 1000000000ULL / 1000;
+		ev[0].type = EV_KEY;
+		ev[0].code = keys[ctr].code;
+		ev[0].value = keys[ctr].value;
+		ev[1].type = EV_SYN;
+		ev[1].code = SYN_REPORT;
+		if (trace_write(&trace, 0, ev, 2) != 0) {
+			trace_close(&trace);
+			return -1;
+		}
+	}
+	return trace_close(&trace);
+}
+
+/* renders the frames of an output file in the form of CHECK_CASE */
+static int16_t readResult(const char *path, char *result, size_t len) {
+	const TRACE_BATCH *batch;
+	const struct input_event *ev;
+	TRACE trace;
+	size_t pos = 0;
+	int16_t count;
+
+	if (trace_open(&trace, path) != 0)
+		return -1;
+	result[0] = '\0';
+	while ((count = trace_next(&trace, &batch, &ev)) > 0 && pos < len) {
+		pos += snprintf(result + pos, len - pos, "%s%u:",
+				pos ? " | " : "", batch->unit);
+		if (pos < len)
+			pos += renderEvents(ev, count, result + pos, len - pos);
+	}
+	trace_close(&trace);
+	return count < 0 || pos >= len ? -1 : 0;
+}
+
+/* appends " type,code,value" for every event but the SYN_REPORTs, returns
+ * how much of buf was used */
+static size_t renderEvents(const struct input_event *ev, int count,
+		char *buf, size_t len) {
+	size_t pos = 0;
+	int ctr;
+
+	buf[0] = '\0';
+	for (ctr = 0; ctr < count && pos < len; ctr++) {
+		if (ev[ctr].type == EV_SYN)
+			continue;
+		pos += snprintf(buf + pos, len - pos, " %u,%u,%d", ev[ctr].type,
+				ev[ctr].code, ev[ctr].value);
+	}
+	return pos < len ? pos : len;
+}
+
+/* the replay reports its throughput, which has no place in the results */
+static int16_t replayQuiet(const char *path, const CONFIG* const config,
+		uint32_t loops, uint8_t threaded, const char *out) {
+	int saved, null;
+	int16_t result;
+
+	fflush(stdout);
+	saved = dup(STDOUT_FILENO);
+	null = open("/dev/null", O_WRONLY);
+	if (saved >= 0 && null >= 0)
+		dup2(null, STDOUT_FILENO);
+	result = replay_run(path, config, config->units, loops, threaded, &output_file,
+			out);
+	fflush(stdout);
+	if (saved >= 0) {
+		dup2(saved, STDOUT_FILENO);
+		close(saved);
+	}
+	if (null >= 0)
+		close(null);
+	return result;
+}
+
+/* the second loop sends what the first one did after the devices were
+ * created, with nothing left over from the first one */
+static int16_t checkLoops(uint8_t threaded) {
+	char conf[64], in[64], out[64];
+	char once[CHECK_RESULT_LEN], twice[CHECK_RESULT_LEN];
+	char expected[2 * CHECK_RESULT_LEN];
+	CONFIG config;
+
+	snprintf(conf, sizeof(conf), "%s/test.conf", checkDir);
+	snprintf(in, sizeof(in), "%s/in.trace", checkDir);
+	snprintf(out, sizeof(out), "%s/out.trace", checkDir);
+
+	config_set_default(&config);
+	if (writeConfig(conf, CHECK_LOOP_CONFIG) != 0
+			|| config_load(&config, conf) != 0
+			|| writeRecording(in, CHECK_KEYS(loopKeys)) != 0
+			|| replayQuiet(in, &config, 1, threaded, out) != 0
+			|| readResult(out, once, sizeof(once)) != 0
+			|| replayQuiet(in, &config, 2, threaded, out) != 0
+			|| readResult(out, twice, sizeof(twice)) != 0
+			|| strncmp(once, CHECK_INIT, strlen(CHECK_INIT)) != 0) {
+		printf("FAIL loops%s: unable to run the replay\n",
+				threaded ? " (threads)" : "");
+		return -1;
+	}
+	snprintf(expected, sizeof(expected), "%s%s", once,
+			once + strlen(CHECK_INIT));
+	if (strcmp(twice, expected) != 0) {
+		printf("FAIL loops%s\n  expected %s\n  got      %s\n",
+				threaded ? " (threads)" : "", expected, twice);
+		return -1;
+	}
+	printf("PASS loops%s\n", threaded ? " (threads)" : "");
+	return 0;
+}
+
+/* two buttons at both ends of a read of 80 events, the ones between
+ * are no keys. Both have to go out in one frame, the end of the replay
+ * releases them. */
+static int16_t checkLongRead(uint8_t threaded) {
+	static const char *expected = CHECK_INIT " | 0: 1,304,1 1,305,1"
+			" | 0: 1,304,0 1,305,0";
+	struct input_event ev[80];
+	char conf[64], in[64], out[64], result[CHECK_RESULT_LEN];
+	TRACE trace = { .fd = -1 };
+	CONFIG config;
+	int ctr;
+
+	snprintf(conf, sizeof(conf), "%s/test.conf", checkDir);
+	snprintf(in, sizeof(in), "%s/in.trace", checkDir);
+	snprintf(out, sizeof(out), "%s/out.trace", checkDir);
+
+	memset(ev, 0, sizeof(ev));
+	for (ctr = 0; ctr < 80; ctr++) {
+		ev[ctr].time.tv_sec = CHECK_START / 1000000000ULL;
+		ev[ctr].type = EV_MSC;
+		ev[ctr].code = MSC_SCAN;
+	}
+	ev[0].type = ev[78].type = EV_KEY;
+	ev[0].code = KEY_LEFTCTRL;
+	ev[78].code = KEY_LEFTALT;
+	ev[0].value = ev[78].value = 1;
+	ev[79].type = EV_SYN;
+	ev[79].code = SYN_REPORT;
+
+	config_set_default(&config);
+	if (writeConfig(conf, "") != 0
+			|| config_load(&config, conf) != 0
+			|| trace_create(&trace, in) != 0
+			|| trace_write(&trace, 0, ev, 80) != 0
+			|| trace_close(&trace) != 0
+			|| replayQuiet(in, &config, 1, threaded, out) != 0
+			|| readResult(out, result, sizeof(result)) != 0) {
+		printf("FAIL long read%s: unable to run the replay\n",
+				threaded ? " (threads)" : "");
+		return -1;
+	}
+	if (strcmp(result, expected) != 0) {
+		printf("FAIL long read%s\n  expected %s\n  got      %s\n",
+				threaded ? " (threads)" : "", expected, result);
+		return -1;
+	}
+	printf("PASS long read%s\n", threaded ? " (threads)" : "");
+	return 0;
+}
+
+/* a memory device keeps the newest events and hands them out in order */
+static int16_t checkMemory() {
+	struct input_event ev[6], got[8];
+	OUTPUT_SPEC spec;
+	OUTPUT_DEV dev;
+	uint16_t count;
+	int ctr;
+
+	output_spec_init(&spec, "x2jcheck");
+	if (output_create(&dev, &output_memory, "4", &spec) != 0) {
+		printf("FAIL memory: unable to create the device\n");
+		return -1;
+	}
+	memset(ev, 0, sizeof(ev));
+	for (ctr = 0; ctr < 6; ctr++) {
+		ev[ctr].type = EV_KEY;
+		ev[ctr].code = BTN_A;
+		ev[ctr].value = ctr;
+	}
+	output_emit(&dev, ev, 3);
+	output_emit(&dev, ev + 3, 3);
+	count = output_memory_read(&dev, got, 8);
+	output_destroy(&dev);
+	for (ctr = 0; ctr < count; ctr++) {
+		if (got[ctr].value != ctr + 2)
+			break;
+	}
+	if (count != 4 || ctr != count) {
+		printf("FAIL memory: got %u events, the first one %d\n", count,
+				count ? got[0].value : -1);
+		return -1;
+	}
+	printf("PASS memory\n");
+	return 0;
+}
+
+/* a read with a SYN_DROPPED keeps what came before and skips the rest of
+ * the broken frame. The resync after it reports every key that changed,
+ * even more than fit into a small read buffer. */
+static int16_t checkDropped() {
+	static const char *expected = " 1,2,1 1,3,1 1,4,1 1,5,1 1,6,1 1,7,1"
+			" 1,8,1 1,9,1 1,10,1 1,11,1 1,16,1 1,17,1 1,18,1 1,19,1 1,20,1"
+			" 1,21,1 1,22,1 1,23,1 1,24,1 1,25,1 1,29,0 1,30,0";
+	struct input_event ev[6];
+	struct timeval time = { 0, 0 };
+	uint8_t keybits[KEY_CNT / 8];
+	char result[CHECK_RESULT_LEN];
+	INP_XARC_DEV xdev;
+	int16_t count;
+	int fds[2], code;
+
+	if (input_xarcade_init(&xdev, 16) != 0 || pipe(fds) != 0) {
+		printf("FAIL dropped: unable to set up the stick\n");
+		return -1;
+	}
+	xdev.fevdev = fds[0];
+	memset(ev, 0, sizeof(ev));
+	ev[0].type = EV_KEY;
+	ev[0].code = KEY_LEFTCTRL;
+	ev[0].value = 1;
+	ev[1].type = EV_SYN;
+	ev[1].code = SYN_REPORT;
+	if (write(fds[1], ev, 2 * sizeof(ev[0])) < 0 || input_xarcade_read(&xdev) != 2) {
+		printf("FAIL dropped: the first read went wrong\n");
+		return -1;
+	}
+	/* a pipe has no key state, so the resync after it adds nothing */
+	ev[0].code = KEY_A;
+	ev[1].code = SYN_DROPPED;
+	ev[2] = ev[0];
+	ev[2].code = KEY_B;
+	ev[3] = ev[1];
+	ev[3].code = SYN_REPORT;
+	ev[4] = ev[0];
+	ev[4].code = KEY_C;
+	ev[5] = ev[3];
+	if (write(fds[1], ev, 6 * sizeof(ev[0])) < 0
+			|| (count = input_xarcade_read(&xdev)) != 1
+			|| xdev.ev[0].code != KEY_A || xdev.dropped) {
+		printf("FAIL dropped: the broken frame was not skipped\n");
+		return -1;
+	}
+	close(fds[0]);
+	close(fds[1]);
+
+	/* a full buffer, 20 keys went down and both held keys came up */
+	memset(keybits, 0, sizeof(keybits));
+	for (code = KEY_1; code <= KEY_0; code++)
+		keybits[code / 8] |= 1 << (code % 8);
+	for (code = KEY_Q; code <= KEY_P; code++)
+		keybits[code / 8] |= 1 << (code % 8);
+	count = input_xarcade_resync(&xdev, xdev.evlen - 1, time, keybits);
+	renderEvents(xdev.ev + xdev.evlen - 1, count - xdev.evlen + 1, result,
+			sizeof(result));
+	code = xdev.ev[count - 1].type;
+	free(xdev.ev);
+	if (strcmp(result, expected) != 0 || code != EV_SYN) {
+		printf("FAIL dropped\n  expected%s\n  got     %s\n", expected, result);
+		return -1;
+	}
+	printf("PASS dropped\n");
+	return 0;
+}